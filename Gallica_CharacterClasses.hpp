@@ -36,6 +36,7 @@ using namespace std;
 
 #include "LinearAlgebra.hpp"
 #include "SdlUtility.hpp"
+#include "Profiler.hpp"
 
 #include "Gallica_Globals.hpp"
 //TODO: #include "powerUps.hpp"
@@ -44,7 +45,8 @@ using namespace std;
 
 
 // Forward declarations
-class ScoreBoard; class Character; class Player; class Obstacle;
+class ScoreBoard; class HudPanel; class Character; class Player;
+class Obstacle;
 Vector vec1 = {1.0, 2.0};
 
 
@@ -77,6 +79,29 @@ private:
 };
 
 
+// The panel at the top of the screen, with the health, armor and stamina
+// of the player. It is composed again only when one of them changes.
+class HudPanel : public Sdl::Widget
+{
+public:
+	// Constructor
+	HudPanel ( );
+	
+	// Modifying methods
+	void setFont ( TTF_Font* );
+	void setValues ( int, int, int );  // Health, armor and stamina
+
+protected:
+	// Modifying methods
+	void compose ( SDL_Surface* );
+	
+	// Attributes
+	TTF_Font* font_;
+	      int values_[3];
+	   string text_;       // Reused to avoid allocating.
+};
+
+
 class Character
 {
 public:
@@ -97,13 +122,14 @@ public:
 protected:
 	// Space attributes
 	Vector position_;
+	Vector previousPosition_;  // Before the last updatePosition()
 	Vector velocity_;
 	double radius_;
 	double maxSpeed_;
 	
 	// Graphics attributes
-	SDL_Surface* spriteSheet_;
-	   SDL_Rect* clips_;
+	Sdl::ImageHandle spriteSheet_;
+	       SDL_Rect* clips_;
 	
 	// Gameplay attributes
 	int healthPoints_;
@@ -129,6 +155,8 @@ public:
 	static constexpr double ACCELERATION = 4.0;
 	static constexpr double DECELERATION = 1.5;
 	
+	static constexpr int MAX_SWEEPS = 3;  // Contacts followed in one step
+	
 	// Constructor and destructor
 	Player ( ) {};
 	Player ( Vector, Vector, double, string );
@@ -137,15 +165,21 @@ public:
 	// Modifying methods
 	void handleInput ( uint8_t* );
 	void handleBorderCollisions ( double, double );
-	void handleObstacleCollisions ( Obstacle* );
+	void handleObstacleCollisions ( const Sdl::RectangleBatch& );
 	
 	void removeNullPowerUps ( );
 	
 	// Non-modifying method
-	void apply ( int );
+	void apply ( Sdl::RenderQueue&, int ) const;
 	
 	// Modifying operators
 	Player& operator = ( const Player& );
+
+protected:
+	// Modifying methods
+	void sweepObstacles ( const Sdl::RectangleBatch& );
+	
+	vector<Sdl::CollisionHit> collisionHits_;  // Reused every frame.
 };
 
 
@@ -167,7 +201,7 @@ public:
 	        double getWidth ( ) const;
 	        double getHeight ( ) const;
 	Sdl::Rectangle getRectangle ( ) const;
-	          void apply ( SDL_Surface* );
+	          void apply ( Sdl::RenderQueue& ) const;
 	
 	// Modifying operator
 	Obstacle& operator = ( const Obstacle& );
@@ -179,21 +213,70 @@ protected:
 	double height_;
 	
 	// Graphics attributes
-	SDL_Surface* spriteSheet_;
+	Sdl::ImageHandle spriteSheet_;
 };
 int Obstacle::count = 0;
 
 
 
 
+HudPanel::HudPanel ( ) : Widget(0, 0, SCREEN_WIDTH, PANEL_HEIGHT),
+                         values_{}
+{
+	font_ = NULL;
+}
+
+
+void HudPanel::setFont ( TTF_Font* font )
+{
+	font_ = font;
+	
+	(*this).invalidate();
+}
+
+
+void HudPanel::setValues ( int health, int armor, int stamina )
+{
+	if ( health != values_[0] or armor != values_[1] or
+	     stamina != values_[2] ) {
+		values_[0] = health;
+		values_[1] = armor;
+		values_[2] = stamina;
+		
+		(*this).invalidate();
+	}
+}
+
+
+void HudPanel::compose ( SDL_Surface* image )
+{
+	SDL_FillRect(image, NULL, SDL_MapRGB(image->format, 10, 10, 10));
+	
+	if ( font_ == NULL )
+		return;
+	
+	text_.assign("HP").append(values_[0], '|');
+	Sdl::FontCache::getAtlas(font_, HUD_HEALTH_COLOR).apply(text_, image,
+	                                                        20, 20);
+	text_.assign("AP").append(values_[1], '|');
+	Sdl::FontCache::getAtlas(font_, HUD_ARMOR_COLOR).apply(text_, image,
+	                                                       220, 20);
+	text_.assign("SP").append(values_[2], '|');
+	Sdl::FontCache::getAtlas(font_, HUD_STAMINA_COLOR).apply(text_, image,
+	                                                         420, 20);
+}
+
+
+
+
 Character::Character ( )
 {
 	position_ = {0, 0};
+	previousPosition_ = {0, 0};
 	velocity_ = {0, 0};
 	radius_ = 0.0;
 	maxSpeed_ = 0.0;
 	
-	spriteSheet_ = NULL;
 	clips_ = NULL;
 	
 	healthPoints_ = 0;
@@ -204,11 +287,14 @@ Character::Character ( )
 
 void Character::updatePosition ( )
 {
+	GALLICA_PROFILE_ZONE("updatePosition");
+	
 	if ( velocity_.magnitude() > maxSpeed_ ) {
 		velocity_.normalise();
 		velocity_ *= maxSpeed_;
 	}
 	
+	previousPosition_ = position_;
 	position_ += velocity_ / SCREEN_FRAMERATE;
 }
 
@@ -261,10 +347,11 @@ Player::Player ( Vector position, Vector velocity, double radius,
                  string imageFileName )
 {
 	position_ = position;
+	previousPosition_ = position;
 	velocity_ = velocity;
 	radius_ = INIT_RADIUS;
 	
-	spriteSheet_ = Sdl::loadImage(imageFileName);
+	spriteSheet_ = Sdl::ImageCache::load(imageFileName);
 	
 	clips_ = new SDL_Rect[CLIPS_COUNT];
 	for ( int i = 0; i < CLIPS_COUNT; i ++ )
@@ -280,8 +367,6 @@ Player::Player ( Vector position, Vector velocity, double radius,
 
 Player::~Player ( )
 {
-	SDL_FreeSurface(spriteSheet_);
-	
 	delete []clips_;
 }
 
@@ -322,6 +407,8 @@ void Player::handleInput ( uint8_t* keyState )
 
 void Player::handleBorderCollisions ( double levelWidth, double levelHeight )
 {
+	GALLICA_PROFILE_ZONE("handleBorderCollisions");
+	
 	if ( position_[0] - radius_ <= 0.0 ) {
 		position_[0] = 0.0 + radius_;
 		velocity_[0] = 0.0;
@@ -341,50 +428,116 @@ void Player::handleBorderCollisions ( double levelWidth, double levelHeight )
 }
 
 
-void Player::handleObstacleCollisions ( Obstacle* obstacles )
+// The move of the step is swept first, so that a fast player can't pass
+// through thin obstacles. The obstacles still overlapped, e.g. by rounding,
+// are found in one pass over their bounds, then tested again one by one as
+// the position is corrected.
+void Player::handleObstacleCollisions ( const Sdl::RectangleBatch& obstacles )
 {
-	for ( int i = 0; i < Obstacle::count; i ++ ) {
-		Sdl::CollisionData results;
-		results = testCollision({position_[0], position_[1], radius_},
-		                        obstacles[i].getRectangle());
+	GALLICA_PROFILE_ZONE("handleObstacleCollisions");
+	
+	(*this).sweepObstacles(obstacles);
+	
+	collisionHits_.clear();
+	obstacles.testCollisions({position_[0], position_[1], radius_},
+	                         collisionHits_);
+	
+	// The batch gives the closest point and the flags of every hit.
+	for ( const Sdl::CollisionHit& hit : collisionHits_ ) {
+		const Sdl::CollisionData& results = hit.data;
 		
-		if ( results.flags & Sdl::COLLISION_TRUE ) {
-			Vector distance = position_ - Vector({results.closestXToFirst,
-			                                     results.closestYToFirst});
-			distance.normalise();
-			
-			position_ = Vector({results.closestXToFirst,
-			                   results.closestYToFirst}) + distance * radius_;
+		Vector distance = position_ - Vector({results.closestXToFirst,
+		                                     results.closestYToFirst});
+		distance.normalise();
+		
+		position_ = Vector({results.closestXToFirst,
+		                   results.closestYToFirst}) + distance * radius_;
+		
+		if (
+		results.flags & Sdl::COLLISION_X_POS or
+		results.flags & Sdl::COLLISION_X_NEG )
+			velocity_[0] = 0.0;
+		else if (
+		results.flags & Sdl::COLLISION_Y_POS or
+		results.flags & Sdl::COLLISION_Y_NEG )
+			velocity_[1] = 0.0;
+	}
+}
+
+
+// The move from the previous position stops where it first touches an
+// obstacle, and what is left of it slides along that obstacle. The
+// obstacles near the move are found with a circle around all of it.
+void Player::sweepObstacles ( const Sdl::RectangleBatch& obstacles )
+{
+	Sdl::Circle start = {previousPosition_[0], previousPosition_[1], radius_};
+	double motionX = position_[0] - start.positionX;
+	double motionY = position_[1] - start.positionY;
+	
+	for ( int i = 0; i < MAX_SWEEPS; i ++ ) {
+		double length = sqrt(motionX * motionX + motionY * motionY);
+		
+		collisionHits_.clear();
+		obstacles.testCollisions({start.positionX + motionX / 2,
+		                          start.positionY + motionY / 2,
+		                          radius_ + length / 2}, collisionHits_);
+		
+		Sdl::SweepData contact = {1.0, 0.0, 0.0, false};
+		for ( const Sdl::CollisionHit& hit : collisionHits_ ) {
+			Sdl::SweepData sweep = Sdl::testSweep(start, motionX, motionY,
+			                       obstacles.getRectangle(hit.rectangleIndex));
 			
-			if (
-			results.flags & Sdl::COLLISION_X_POS or
-			results.flags & Sdl::COLLISION_X_NEG )
-				velocity_[0] = 0.0;
-			else if (
-			results.flags & Sdl::COLLISION_Y_POS or
-			results.flags & Sdl::COLLISION_Y_NEG )
-				velocity_[1] = 0.0;
+			if ( sweep.isHit and sweep.time < contact.time )
+				contact = sweep;
+		}
+		
+		// Without a normal, the player is already inside an obstacle.
+		if ( not contact.isHit or
+		     (contact.normalX == 0.0 and contact.normalY == 0.0) ) {
+			start.positionX += motionX;
+			start.positionY += motionY;
+			break;
+		}
+		
+		start.positionX += motionX * contact.time;
+		start.positionY += motionY * contact.time;
+		motionX *= 1.0 - contact.time;
+		motionY *= 1.0 - contact.time;
+		
+		double motionIn = motionX * contact.normalX + motionY * contact.normalY;
+		motionX -= motionIn * contact.normalX;
+		motionY -= motionIn * contact.normalY;
+		
+		double velocityIn = velocity_[0] * contact.normalX +
+		                    velocity_[1] * contact.normalY;
+		if ( velocityIn < 0.0 ) {
+			velocity_[0] -= velocityIn * contact.normalX;
+			velocity_[1] -= velocityIn * contact.normalY;
 		}
 	}
+	
+	position_[0] = start.positionX;
+	position_[1] = start.positionY;
 }
 
 
 inline
-void Player::apply ( int clipIndex )
+void Player::apply ( Sdl::RenderQueue& renderQueue, int clipIndex ) const
 {
-	Sdl::applySurface(spriteSheet_, screen, SCREEN_WIDTH / 2 - radius_,
-	                  (SCREEN_HEIGHT + PANEL_HEIGHT) / 2 - radius_,
-	                  &clips_[clipIndex]);
+	renderQueue.submit(spriteSheet_.getSurface(), position_[0] - radius_,
+	                   position_[1] - radius_, &clips_[clipIndex],
+	                   LAYER_CHARACTERS);
 }
 
 
 Player& Player::operator = ( const Player& model )
 {
 	position_ = model.position_;
+	previousPosition_ = model.previousPosition_;
 	velocity_ = model.velocity_;
 	radius_ = model.radius_;
 	
-	spriteSheet_ = SDL_DisplayFormatAlpha(model.spriteSheet_);
+	spriteSheet_ = model.spriteSheet_.share();
 	
 	delete[] clips_;
 	clips_ = new SDL_Rect[CLIPS_COUNT];
@@ -408,8 +561,6 @@ Obstacle::Obstacle ( )
 	width_ = 0.0;
 	height_ = 0.0;
 	
-	spriteSheet_ = NULL;
-	
 	count ++;
 }
 
@@ -421,7 +572,7 @@ Obstacle::Obstacle ( string imageFileName, Vector initPosition,
 	width_ = initWidth;
 	height_ = initHeight;
 	
-	spriteSheet_ = Sdl::loadImage(imageFileName);
+	spriteSheet_ = Sdl::ImageCache::load(imageFileName);
 	
 	count ++;
 }
@@ -430,8 +581,6 @@ Obstacle::Obstacle ( string imageFileName, Vector initPosition,
 inline
 Obstacle::~Obstacle ( )
 {
-	SDL_FreeSurface(spriteSheet_);
-	
 	count --;
 }
 
@@ -464,10 +613,11 @@ Sdl::Rectangle Obstacle::getRectangle ( ) const
 }
 
 
-void Obstacle::apply ( SDL_Surface* destination )
+inline
+void Obstacle::apply ( Sdl::RenderQueue& renderQueue ) const
 {
-	Sdl::applySurface(spriteSheet_, destination, position_[0] - width_ / 2,
-	                  position_[1] - height_ / 2);
+	renderQueue.submit(spriteSheet_.getSurface(), position_[0] - width_ / 2,
+	                   position_[1] - height_ / 2, NULL, LAYER_OBSTACLES);
 }
 
 
@@ -477,7 +627,7 @@ Obstacle& Obstacle::operator = ( const Obstacle& model)
 	width_ = model.width_;
 	height_ = model.height_;
 	
-	spriteSheet_ = SDL_DisplayFormatAlpha(model.spriteSheet_);
+	spriteSheet_ = model.spriteSheet_.share();
 	
 	return *this;
 }
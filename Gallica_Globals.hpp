@@ -39,7 +39,15 @@ const string INTRO_FONT_FILENAME = "TestFont.ttf";
 const string MENU_FONT_FILENAME = "TestFont.ttf";
 const string PAUSE_FONT_FILENAME = "TestFont.ttf";
 
+const int UI_FONT_SIZE = 20;  // When Ui.cfg doesn't give one.
+
+const SDL_Color HUD_HEALTH_COLOR = {255, 10, 10, 0};
+const SDL_Color HUD_ARMOR_COLOR = {0, 100, 255, 0};
+const SDL_Color HUD_STAMINA_COLOR = {10, 255, 10, 0};
+
 const string INTRO_BACKGROUND_FILENAME = "IntroBackground.png";
+const string MENU_BACKGROUND_FILENAME = "MenuBackground.png";
+const string START_BUTTON_FILENAME = "StartButton.png";
 
 
 enum StateCode {STATE_NULL,
@@ -49,3 +57,8 @@ enum StateCode {STATE_NULL,
                 STATE_INTRO,
                 STATE_MAIN_MENU};
 
+
+enum RenderLayer {LAYER_FLOOR,
+                  LAYER_OBSTACLES,
+                  LAYER_CHARACTERS};
+
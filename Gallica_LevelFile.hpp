@@ -0,0 +1,278 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : Gallica_LevelFile.hpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 19 2026
+// DESCRIPTION : Readers of the sections of the level files and of Ui.cfg.
+//     REMARKS : All functions in this file are under the namespace
+//               'LevelFile'. They only fill descriptions, which ActiveLevel
+//               turns into fonts, images and characters, so they don't need
+//               SDL and can be tested and benchmarked on their own.
+//               A section is a line "[Name]" followed by "property = value"
+//               lines, up to the next section. Names are case insensitive.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+using namespace std;
+
+
+//{ Includes
+
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <istream>
+#include <limits>
+#include <vector>
+
+#include "LinearAlgebra.hpp"
+
+//}
+
+
+
+
+//{ Declarations
+
+//{ Structures
+
+struct LevelData
+{
+	double width;
+	double height;
+	   int maxAiCount;
+	string floorImageFilename;  // Empty when the level has none.
+};
+
+
+struct PanelSettings
+{
+	string fontFilename;
+	   int fontSize;
+};
+
+
+struct PlayerData
+{
+	Vector position;
+	Vector velocity;
+	string spriteSheetFilename;
+};
+
+
+struct ObstacleData
+{
+	string imageFilename;
+	Vector position;
+	double width;
+	double height;
+	  bool isRead;         // False when its section is missing or incomplete.
+};
+
+//}
+
+
+//{ Functions
+
+namespace LevelFile
+{
+	void toUpper ( string& );
+	bool isSectionEnd ( istream& );
+	
+	bool findSection ( istream&, string );
+	
+	void readPanelSettings ( istream&, PanelSettings& );
+	void readLevelData ( istream&, LevelData& );
+	void readPlayer ( istream&, PlayerData& );
+	void readObstacles ( istream&, vector<ObstacleData>& );
+	void readObstacleSection ( istream&, ObstacleData& );
+}
+
+//}
+
+//}
+
+
+
+
+//{ LevelFile
+
+inline
+void LevelFile::toUpper ( string& text )
+{
+	for ( int i = 0; i < int(text.length()); i ++ )
+		text[i] = toupper(text[i]);
+}
+
+
+// True at the end of the stream or before the next section header.
+inline
+bool LevelFile::isSectionEnd ( istream& source )
+{
+	return ws(source).eof() or source.peek() == '[';
+}
+
+
+// Leaves the stream after the header of the first section with this name,
+// from the start of the stream. False when there is no such section.
+bool LevelFile::findSection ( istream& source, string section )
+{
+	toUpper(section);
+	
+	source.clear();
+	source.seekg(0);
+	
+	while ( not ws(source).eof() ) {
+		source.ignore(numeric_limits<streamsize>::max(), '[');
+		
+		string currentSection;
+		getline(source, currentSection);
+		toUpper(currentSection);
+		
+		if ( currentSection == section + "]" )
+			return true;
+	}
+	
+	return false;
+}
+
+
+void LevelFile::readPanelSettings ( istream& source, PanelSettings& settings )
+{
+	if ( not findSection(source, "PANEL") )
+		return;
+	
+	while ( not isSectionEnd(source) ) {
+		string currentProperty;
+		source >> currentProperty;
+		toUpper(currentProperty);
+		
+		source.ignore(3);
+		
+		if ( currentProperty == "FONTFILENAME" )
+			getline(source, settings.fontFilename);
+		else if ( currentProperty == "FONTSIZE" )
+			source >> settings.fontSize;
+	}
+}
+
+
+// Reads the section the stream is in, e.g. after findSection("LEVEL").
+void LevelFile::readLevelData ( istream& source, LevelData& data )
+{
+	while ( not isSectionEnd(source) ) {
+		string currentProperty;
+		source >> currentProperty;
+		toUpper(currentProperty);
+		
+		source.ignore(3);
+		
+		if ( currentProperty == "WIDTH" )
+			source >> data.width;
+		else if ( currentProperty == "HEIGHT" )
+			source >> data.height;
+		else if ( currentProperty == "FLOORIMAGEFILENAME" )
+			getline(source, data.floorImageFilename);
+		else if ( currentProperty == "MAXAICOUNT" )
+			source >> data.maxAiCount;
+	}
+}
+
+
+// Reads the section the stream is in, e.g. after findSection("PLAYER").
+void LevelFile::readPlayer ( istream& source, PlayerData& player )
+{
+	player.position = Vector(2);
+	player.velocity = Vector(2);
+	
+	while ( not isSectionEnd(source) ) {
+		string currentProperty;
+		source >> currentProperty;
+		toUpper(currentProperty);
+		
+		source.ignore(3);
+		
+		if ( currentProperty == "INITPOSITION" )
+			source >> player.position[0] >> player.position[1];
+		else if ( currentProperty == "INITVELOCITY" )
+			source >> player.velocity[0] >> player.velocity[1];
+		else if ( currentProperty == "SPRITESHEETFILENAME" )
+			getline(source, player.spriteSheetFilename);
+	}
+}
+
+
+// Reads the count of the [Obstacles] section the stream is in, then the
+// [ObstacleN] sections in a single pass over the whole stream, in whatever
+// order they come, before or after [Obstacles]. Numbers outside 1..count are
+// ignored.
+void LevelFile::readObstacles ( istream& source,
+                                vector<ObstacleData>& obstacles )
+{
+	source.ignore(numeric_limits<streamsize>::max(), '=');
+	
+	int numberOfObstacles = 0;
+	source >> numberOfObstacles;
+	
+	obstacles.assign(max(numberOfObstacles, 0), ObstacleData());
+	
+	source.clear();
+	source.seekg(0);
+	
+	while ( not ws(source).eof() ) {
+		source.ignore(numeric_limits<streamsize>::max(), '[');
+		
+		string currentSection;
+		source >> currentSection;
+		toUpper(currentSection);
+		
+		if (
+			currentSection.compare(0, 8, "OBSTACLE") == 0 and
+			currentSection.back() == ']' ) {
+			int obstacleNumber = atoi(currentSection.c_str() + 8);
+			
+			if ( obstacleNumber >= 1 and obstacleNumber <= numberOfObstacles )
+				readObstacleSection(source, obstacles[obstacleNumber - 1]);
+		}
+	}
+}
+
+
+// An obstacle is only read when its section has its four properties.
+void LevelFile::readObstacleSection ( istream& source, ObstacleData& obstacle )
+{
+	obstacle.position = Vector(2);
+	
+	uint8_t endBits = 0;
+	
+	while ( endBits != 15 and not isSectionEnd(source) ) {
+		string currentProperty;
+		source >> currentProperty;
+		toUpper(currentProperty);
+		
+		source.ignore(3);
+		
+		if ( currentProperty == "IMAGEFILENAME" ) {
+			getline(source, obstacle.imageFilename);
+			endBits |= 1;
+		}
+		else if ( currentProperty == "POSITION" ) {
+			source >> obstacle.position[0] >> obstacle.position[1];
+			endBits |= 2;
+		}
+		else if ( currentProperty == "WIDTH" ) {
+			source >> obstacle.width;
+			endBits |= 4;
+		}
+		else if ( currentProperty == "HEIGHT" ) {
+			source >> obstacle.height;
+			endBits |= 8;
+		}
+	}
+	
+	obstacle.isRead = endBits == 15;
+}
+
+//}
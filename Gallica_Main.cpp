@@ -19,6 +19,7 @@ using namespace std;
 
 #include "SdlUtility.hpp"
 #include "LinearAlgebra.hpp"
+#include "Profiler.hpp"
 
 #include "Gallica_Globals.hpp"
 #include "Gallica_CharacterClasses.hpp"
@@ -55,7 +56,7 @@ int main ( int, char** )
 		errLog.close();
 	}
 	
-	TTF_Font* goodbyeFont = TTF_OpenFont("TestFont.ttf", 40);
+	TTF_Font* goodbyeFont = Sdl::FontCache::getFont("TestFont.ttf", 40);
 	
 	SDL_FillRect(screen, NULL, 0);
 	
@@ -65,6 +66,20 @@ int main ( int, char** )
 	
 	Sdl::wait(1000);
 	
+	Sdl::FontCache::clear();
+	Sdl::ImageCache::clear();
+	Sdl::ImageLoader::stop();
+	
+#ifndef GALLICA_NO_PROFILING
+	Profiling::exportChromeTrace("GallicaTrace.json");
+	
+	ofstream profileLog("GallicaProfile.txt");
+	Profiling::printSummary(profileLog);
+	Sdl::ImageCache::printStatistics(profileLog);
+	GameState::eventPump.printStatistics(profileLog);
+	profileLog.close();
+#endif
+	
 	SDL_Quit();
 	
 	return 0;
@@ -23,10 +23,12 @@ using namespace std;
 #include "SDL/SDL_ttf.h"
 
 #include "SdlUtility.hpp"
+#include "Profiler.hpp"
 #include "LinearAlgebra.hpp"
 
 #include "Gallica_Globals.hpp"
 #include "Gallica_CharacterClasses.hpp"
+#include "Gallica_LevelFile.hpp"
 
 //}
 
@@ -35,18 +37,6 @@ using namespace std;
 
 //{ Declarations
 
-//{ Structures
-
-struct LevelData
-{
-	double width;
-	double height;
-	   int maxAiCount;
-};
-
-//}
-
-
 //{ Classes
 
 // Forward declarations
@@ -57,9 +47,12 @@ class GameState
 {
 public:
 	// Static attributes
-	static int currentStateCode;
+	static            int currentStateCode;
+	static Sdl::EventPump eventPump;  // Shared, to measure the whole run.
 	
 	// Constructor and destructor
+	GameState ( ) : framePacer_(SCREEN_FRAMERATE),
+	                dirtyRegions_(SCREEN_WIDTH, SCREEN_HEIGHT) {};
 	virtual ~GameState ( ) {};
 	
 	// Methods
@@ -69,12 +62,13 @@ public:
 	virtual void renderScreen ( ) = 0;
 
 protected:
-	     SDL_Event inputEvent_;
-	Sdl::MouseData mouseState_;
-	      uint8_t* keyboardState_;
-	    Sdl::Timer framerateTimer_;
+	   Sdl::MouseData mouseState_;
+	         uint8_t* keyboardState_;
+	  Sdl::FramePacer framePacer_;
+	Sdl::DirtyRegions dirtyRegions_;  // Drawn on since the last update
 };
 int GameState::currentStateCode = STATE_NULL;
+Sdl::EventPump GameState::eventPump;
 
 
 class Intro : public GameState
@@ -111,28 +105,31 @@ public:
 	void renderScreen ( );
 
 protected:
-	Sdl::Button* buttons_;
-	SDL_Surface* background_;
+	    Sdl::Button* buttons_;
+	Sdl::ImageHandle background_;
 };
 
 
 class ActiveLevel : public GameState
 {
 public:
-	ActiveLevel ( ) {};
-	~ActiveLevel ( );
+	ActiveLevel ( ) : renderQueue_(SCREEN_WIDTH, SCREEN_HEIGHT),
+	                  renderedX_(0.0), renderedY_(0.0) {};
+	
+	static void prefetchFiles ( int );  // State code of the level
 	
 	void loadFiles ( );
 	void executeLoop ( );
 	void handleEvents ( bool& );
 	void renderScreen ( );
 	
-	void parseSettingsFile ( ifstream& );
-	void parseLevelFile ( ifstream&, string, void (ActiveLevel::*)(ifstream&) );
-	void parseData ( ifstream& );
-	void parsePlayer ( ifstream& );
-	void parseObstacles ( ifstream& );
-	void readObstacleSection ( ifstream&, int );
+	// The text is read by the functions of "Gallica_LevelFile.hpp"; these
+	// load what it describes.
+	void parseSettingsFile ( istream& );
+	void parseLevelFile ( istream&, string, void (ActiveLevel::*)(istream&) );
+	void parseData ( istream& );
+	void parsePlayer ( istream& );
+	void parseObstacles ( istream& );
 	
 	void applyUi ( );
 	void applyBackground ( );
@@ -140,11 +137,19 @@ public:
 protected:
 	LevelData data_;
 	
-	   Player player_;
-	Obstacle* allObstacles_;
+	             Player player_;
+	          Obstacle* allObstacles_;
+	Sdl::RectangleBatch obstacleBounds_;
+	
+	       TTF_Font* uiFont_;
+	        HudPanel hudPanel_;
+	Sdl::ImageHandle floorImage_;
 	
-	   TTF_Font* uiFont_;
-	SDL_Surface* floorImage_;
+	Sdl::RenderQueue renderQueue_;  // The camera is its viewport.
+	
+	// Last rendered position, to redraw only when the camera moves
+	double renderedX_;
+	double renderedY_;
 };
 
 //}
@@ -171,9 +176,14 @@ Intro::~Intro ( )
 }
 
 
+// The main menu's images are decoded in the background while the title is
+// shown.
 void Intro::loadFiles ( )
 {
-	TTF_Font* titleFont = TTF_OpenFont(INTRO_FONT_FILENAME.c_str(), 40);
+	Sdl::ImageCache::prefetch(MENU_BACKGROUND_FILENAME);
+	Sdl::ImageCache::prefetch(START_BUTTON_FILENAME);
+	
+	TTF_Font* titleFont = Sdl::FontCache::getFont(INTRO_FONT_FILENAME, 40);
 	
 	SDL_Surface* background = Sdl::loadImage(INTRO_BACKGROUND_FILENAME.c_str());
 	
@@ -191,7 +201,6 @@ void Intro::loadFiles ( )
 	
 	SDL_FreeSurface(background);
 	SDL_FreeSurface(text);
-	TTF_CloseFont(titleFont);
 }
 
 
@@ -199,22 +208,21 @@ void Intro::executeLoop ( )
 {
 	int frameCounter = 0;
 	
+	framePacer_.start();
 	bool introDone = false;
 	while ( not introDone ) {
-		framerateTimer_.start();
-		
 		this->handleEvents(introDone);
 		
 		if ( frameCounter >= 1.5 * SCREEN_FRAMERATE )
 			introDone = true;
 		
 		this->renderScreen();
+		eventPump.markPresented();
 		
 		frameCounter ++;
 		
-		Sdl::wait(1000 / SCREEN_FRAMERATE - framerateTimer_.getTicks());
+		framePacer_.waitNextFrame();
 	}
-	framerateTimer_.stop();
 	
 	setNextState(STATE_MAIN_MENU);
 }
@@ -222,24 +230,28 @@ void Intro::executeLoop ( )
 
 void Intro::handleEvents ( bool& endLoop )
 {
-	SDL_PollEvent(&inputEvent_);
-	
-	if ( inputEvent_.type == SDL_QUIT ) {
-		setNextState(STATE_EXIT);
-		endLoop = true;
+	for ( const SDL_Event& event : eventPump.pump() ) {
+		if ( event.type == SDL_QUIT ) {
+			setNextState(STATE_EXIT);
+			endLoop = true;
+		}
+		else if ( event.type == SDL_KEYDOWN and
+		          event.key.keysym.sym == SDLK_ESCAPE )
+			endLoop = true;
 	}
-	else if ( inputEvent_.key.keysym.sym == SDLK_ESCAPE )
-		endLoop = true;
 }
 
 
+// The title is still, so it is only drawn once.
 void Intro::renderScreen ( )
 {
-	SDL_FillRect(screen, NULL, 0);
-	
-	Sdl::applySurface(titleImage_, screen, 0, 0);
+	if ( dirtyRegions_.isInvalidated() ) {
+		SDL_FillRect(screen, NULL, 0);
+		
+		Sdl::applySurface(titleImage_, screen, 0, 0);
+	}
 	
-	SDL_Flip(screen);
+	dirtyRegions_.update(screen);
 }
 
 //}
@@ -249,64 +261,86 @@ void Intro::renderScreen ( )
 
 MainMenu::~MainMenu ( )
 {
-	SDL_FreeSurface(background_);
-	
 	delete []buttons_;
 }
 
 
+// The first level's images are decoded in the background while the menu is
+// shown.
 void MainMenu::loadFiles ( )
 {
-	background_ = Sdl::loadImage("MenuBackground.png");
+	background_ = Sdl::ImageCache::load(MENU_BACKGROUND_FILENAME);
 	
 	buttons_ = new Sdl::Button[1];
-	buttons_[0] = Sdl::Button("StartButton.png", 500, 400, 200, 50);
+	buttons_[0] = Sdl::Button(START_BUTTON_FILENAME, 500, 400, 200, 50);
+	
+	ActiveLevel::prefetchFiles(STATE_LEVEL_1);
 }
 
 
 void MainMenu::executeLoop ( )
 {
+	framePacer_.start();
 	bool menuDone = false;
 	while ( not menuDone ) {
-		framerateTimer_.start();
-		
 		this->handleEvents(menuDone);
 		
 		this->renderScreen();
+		eventPump.markPresented();
 		
-		Sdl::wait(1000 / SCREEN_FRAMERATE - framerateTimer_.getTicks());
+		framePacer_.waitNextFrame();
 	}
-	framerateTimer_.stop();
 }
 
 
 void MainMenu::handleEvents ( bool& endLoop )
 {
-	SDL_PollEvent(&inputEvent_);
+	for ( const SDL_Event& event : eventPump.pump() ) {
+		if ( event.type == SDL_QUIT ) {
+			setNextState(STATE_EXIT);
+			endLoop = true;
+		}
+	}
+	
 	mouseState_ = Sdl::getMouseState ( );
 	
 	buttons_[0].handleInput(mouseState_);
 	
-	if ( inputEvent_.type == SDL_QUIT ) {
-		setNextState(STATE_EXIT);
-		endLoop = true;
-	}
-	else if ( buttons_[0].isClicked() ) {
+	if ( not endLoop and buttons_[0].isClicked() ) {
 		setNextState(STATE_LEVEL_1);
 		endLoop = true;
 	}
 }
 
 
+// Only the button changes after the first frame, so only its region is
+// redrawn over the background, when it shows another state.
 void MainMenu::renderScreen ( )
 {
-	SDL_FillRect(screen, NULL, 0);
-	
-	Sdl::applySurface(background_, screen, 0, 0);
+	SDL_Rect buttonRect = {Sint16(buttons_[0].getPositionX()),
+	                       Sint16(buttons_[0].getPositionY()),
+	                       Uint16(buttons_[0].getWidth()),
+	                       Uint16(buttons_[0].getHeight())};
 	
-	buttons_[0].apply(screen);
+	if ( dirtyRegions_.isInvalidated() ) {
+		SDL_FillRect(screen, NULL, 0);
+		
+		Sdl::applySurface(background_.getSurface(), screen, 0, 0);
+		
+		buttons_[0].apply(screen);
+	}
+	else if ( buttons_[0].hasChanged() ) {
+		SDL_Rect clip = buttonRect;
+		SDL_FillRect(screen, &clip, 0);
+		
+		Sdl::applySurface(background_.getSurface(), screen, buttonRect.x,
+		                  buttonRect.y, &clip);
+		
+		buttons_[0].apply(screen);
+		dirtyRegions_.add(buttonRect);
+	}
 	
-	SDL_Flip(screen);
+	dirtyRegions_.update(screen);
 }
 
 //}
@@ -314,10 +348,37 @@ void MainMenu::renderScreen ( )
 
 //{ ActiveLevel
 
-ActiveLevel::~ActiveLevel ( )
+// Starts decoding the images named in the level file, e.g. while a menu is
+// shown. The file is read as loadFiles() reads it, for the filenames only.
+void ActiveLevel::prefetchFiles ( int stateCode )
 {
-	TTF_CloseFont(uiFont_);
-	SDL_FreeSurface(floorImage_);
+	ifstream levelFile("Level" + to_string(stateCode));
+	vector<string> filenames;
+	
+	if ( LevelFile::findSection(levelFile, "LEVEL") ) {
+		LevelData level;
+		LevelFile::readLevelData(levelFile, level);
+		filenames.push_back(level.floorImageFilename);
+	}
+	
+	if ( LevelFile::findSection(levelFile, "PLAYER") ) {
+		PlayerData player;
+		LevelFile::readPlayer(levelFile, player);
+		filenames.push_back(player.spriteSheetFilename);
+	}
+	
+	if ( LevelFile::findSection(levelFile, "OBSTACLES") ) {
+		vector<ObstacleData> obstacles;
+		LevelFile::readObstacles(levelFile, obstacles);
+		
+		for ( const ObstacleData& obstacle : obstacles )
+			if ( obstacle.isRead )
+				filenames.push_back(obstacle.imageFilename);
+	}
+	
+	for ( const string& filename : filenames )
+		if ( not filename.empty() )
+			Sdl::ImageCache::prefetch(filename);
 }
 
 
@@ -335,7 +396,9 @@ void ActiveLevel::loadFiles ( )
 	levelFile.close();
 	
 	for ( int i = 0; i < Obstacle::count; i ++ )
-		allObstacles_[i].apply(floorImage_);
+		obstacleBounds_.add(allObstacles_[i].getRectangle());
+	
+	hudPanel_.setFont(uiFont_);
 }
 
 
@@ -343,258 +406,152 @@ void ActiveLevel::executeLoop ( )
 {
 	bool gamePaused = false;
 	
+	framePacer_.start();
 	bool levelDone = false;
 	while ( not levelDone ) {
-		framerateTimer_.start();
-		
 		this->handleEvents(levelDone);
 		
 		player_.updatePosition();
 		
 		player_.handleBorderCollisions(data_.width, data_.height);
 		
-		player_.handleObstacleCollisions(allObstacles_);
+		player_.handleObstacleCollisions(obstacleBounds_);
 		
 		this->renderScreen();
+		eventPump.markPresented();
 		
-		Sdl::wait(1000 / SCREEN_FRAMERATE - framerateTimer_.getTicks());
+		framePacer_.waitNextFrame();
 	}
-	framerateTimer_.stop();
 }
 
 
 void ActiveLevel::handleEvents ( bool& endLoop )
 {
-	SDL_PollEvent(&inputEvent_);
-	mouseState_ = Sdl::getMouseState();
-	keyboardState_ = SDL_GetKeyState(NULL);
+	GALLICA_PROFILE_ZONE("handleEvents");
 	
-	if ( inputEvent_.type == SDL_QUIT ) {
-		setNextState(STATE_EXIT);
-		endLoop = true;
+	for ( const SDL_Event& event : eventPump.pump() ) {
+		if ( event.type == SDL_QUIT ) {
+			setNextState(STATE_EXIT);
+			endLoop = true;
+		}
 	}
 	
+	mouseState_ = Sdl::getMouseState();
+	keyboardState_ = SDL_GetKeyState(NULL);
+	
 	player_.handleInput(keyboardState_);
 }
 
 
 void ActiveLevel::renderScreen ( )
 {
-	SDL_FillRect(screen, NULL, SDL_MapRGB(screen->format, 60, 60, 60));
+	GALLICA_PROFILE_ZONE("renderScreen");
 	
-	this->applyBackground();
+	// The camera follows the player, so any move scrolls the whole screen.
+	if ( player_.getPosition()[0] != renderedX_ or
+	     player_.getPosition()[1] != renderedY_ )
+		dirtyRegions_.invalidate();
 	
-	player_.apply(Player::CLIP_DEFAULT);
+	hudPanel_.setValues(player_.getHealth(), player_.getArmor(),
+	                    player_.getStamina());
 	
-	this->applyUi();
-	
-	SDL_Flip(screen);
-}
-
-
-void ActiveLevel::parseSettingsFile ( ifstream& settingsFile )
-{
-	string uiFontFilename;
-	int uiFontSize;
-	
-	while ( not ws(settingsFile).eof() ) {
-		settingsFile.ignore(numeric_limits<streamsize>::max(), '[');
-		string currentSection;
-		getline(settingsFile, currentSection);
-		for ( int i = 0; i < currentSection.length(); i ++ )
-			currentSection[i] = toupper(currentSection[i]);
+	if ( dirtyRegions_.isInvalidated() ) {
+		SDL_FillRect(screen, NULL, SDL_MapRGB(screen->format, 60, 60, 60));
+		
+		// The obstacles outside the camera are culled by the queue.
+		renderQueue_.setViewport(player_.getPosition()[0] - SCREEN_WIDTH / 2,
+		                         player_.getPosition()[1] -
+		                         (SCREEN_HEIGHT + PANEL_HEIGHT) / 2);
 		
-		if ( currentSection == "PANEL]" )
-			while ( settingsFile.peek() != '[' and 
-			not ws(settingsFile).eof() ) {
-				string currentProperty;
-				settingsFile >> currentProperty;
-				for ( int i = 0; i < currentProperty.length(); i ++ )
-					currentProperty[i] = toupper(currentProperty[i]);
-				
-				settingsFile.ignore(3);
-				
-				if ( currentProperty == "FONTFILENAME" )
-					getline(settingsFile, uiFontFilename);
-				else if ( currentProperty == "FONTSIZE" )
-					settingsFile >> uiFontSize;
-			}
+		this->applyBackground();
 		
-		uiFont_ = TTF_OpenFont(uiFontFilename.c_str(), uiFontSize);
+		for ( int i = 0; i < Obstacle::count; i ++ )
+			allObstacles_[i].apply(renderQueue_);
+		
+		player_.apply(renderQueue_, Player::CLIP_DEFAULT);
+		
+		renderQueue_.execute(screen);
+		
+		this->applyUi();
+		
+		renderedX_ = player_.getPosition()[0];
+		renderedY_ = player_.getPosition()[1];
 	}
+	else if ( hudPanel_.hasChanged() )
+		this->applyUi();
+	
+	dirtyRegions_.update(screen);
 }
 
 
-void ActiveLevel::parseLevelFile ( ifstream& levelFile, string section,
-                                   void (ActiveLevel::*parsingMethod)(
-                                   ifstream&) )
+void ActiveLevel::parseSettingsFile ( istream& settingsFile )
 {
-	for ( int i = 0; i < section.length(); i ++ )
-		section[i] = toupper(section[i]);
+	PanelSettings settings = {UI_FONT_FILENAME, UI_FONT_SIZE};
+	LevelFile::readPanelSettings(settingsFile, settings);
 	
-	levelFile.seekg(0);
-	
-	bool endRead = false;
-	while ( not endRead ) {
-		levelFile.ignore(numeric_limits<streamsize>::max(), '[');
-		
-		string currentSection;
-		getline(levelFile, currentSection);
-		for ( int i = 0; i < currentSection.length(); i ++ )
-			currentSection[i] = toupper(currentSection[i]);
-		
-		if ( currentSection == section + "]" ) {
-			(this->*parsingMethod)(levelFile);
-			endRead = true;
-		}
-	}
+	uiFont_ = Sdl::FontCache::getFont(settings.fontFilename, settings.fontSize);
 }
 
 
-void ActiveLevel::parseData ( ifstream& levelFile )
+void ActiveLevel::parseLevelFile ( istream& levelFile, string section,
+                                   void (ActiveLevel::*parsingMethod)(
+                                   istream&) )
 {
-	while ( not levelFile.eof() ) {
-		string currentProperty;
-		levelFile >> currentProperty;
-		for ( int i = 0; i < currentProperty.length(); i ++ )
-			currentProperty[i] = toupper(currentProperty[i]);
-		
-		levelFile.ignore(3);
-		
-		if ( currentProperty == "WIDTH" )
-			levelFile >> data_.width;
-		else if ( currentProperty == "HEIGHT" )
-			levelFile >> data_.height;
-		else if ( currentProperty == "FLOORIMAGEFILENAME" ) {
-			string floorImageFilename;
-			getline(levelFile, floorImageFilename);
-			floorImage_ = Sdl::loadImage(floorImageFilename);
-		}
-		else if ( currentProperty == "MAXAICOUNT" )
-			levelFile >> data_.maxAiCount;
-	}
+	if ( LevelFile::findSection(levelFile, section) )
+		(this->*parsingMethod)(levelFile);
 }
 
 
-void ActiveLevel::parsePlayer ( ifstream& levelFile)
+void ActiveLevel::parseData ( istream& levelFile )
 {
-	Vector initPosition(2);
-	Vector initVelocity(2);
-	string spriteSheetFilename;
-	
-	while ( not levelFile.eof() ) {
-		string currentProperty;
-		levelFile >> currentProperty;
-		for ( int i = 0; i < currentProperty.length(); i ++ )
-			currentProperty[i] = toupper(currentProperty[i]);
-		
-		levelFile.ignore(3);
-		
-		if ( currentProperty == "INITPOSITION" ) {
-			levelFile >> initPosition[0] >> initPosition[1];
-		}
-		else if ( currentProperty == "INITVELOCITY" ) {
-			levelFile >> initVelocity[0] >> initVelocity[1];
-		}
-		else if ( currentProperty == "SPRITESHEETFILENAME" )
-			getline(levelFile, spriteSheetFilename);
-	}
+	LevelFile::readLevelData(levelFile, data_);
 	
-	player_ = Player(initPosition, initVelocity, Player::INIT_RADIUS,
-	                 spriteSheetFilename);
+	if ( not data_.floorImageFilename.empty() )
+		floorImage_ = Sdl::ImageCache::load(data_.floorImageFilename);
 }
 
 
-void ActiveLevel::parseObstacles ( ifstream& levelFile )
+void ActiveLevel::parsePlayer ( istream& levelFile )
 {
-	levelFile.ignore(numeric_limits<streamsize>::max(), '=');
-	
-	int numberOfObstacles;
-	levelFile >> numberOfObstacles;
-	
-	allObstacles_ = new Obstacle[numberOfObstacles];
-	
-	for ( int i = 0; i < Obstacle::count; i ++ ) {
-		levelFile.clear();
-		levelFile.seekg(0);
-		while ( not ws(levelFile).eof() ) {
-			levelFile.ignore(numeric_limits<streamsize>::max(), '[');
-			
-			string currentSection;
-			levelFile >> currentSection;
-			for ( int j = 0; j < currentSection.length(); j ++ )
-				currentSection[j] = toupper(currentSection[j]);
-			
-			if ( currentSection == "OBSTACLE" + to_string(i + 1) + "]" ) {
-				this->readObstacleSection(levelFile, i);
-			}
-		}
-	}
+	PlayerData player;
+	LevelFile::readPlayer(levelFile, player);
+	
+	player_ = Player(player.position, player.velocity, Player::INIT_RADIUS,
+	                 player.spriteSheetFilename);
 }
 
 
-void ActiveLevel::readObstacleSection ( ifstream& levelFile, int obstacleIndex )
+// Obstacles without a complete section keep their default construction.
+void ActiveLevel::parseObstacles ( istream& levelFile )
 {
-	string imageFileName;
-	Vector initPosition(2);
-	double initWidth;
-	double initHeight;
-	
-	uint8_t endBits = 0;
-	
-	while ( endBits != 15 ) {
-		string currentProperty;
-		levelFile >> currentProperty;
-		for ( int i = 0; i < currentProperty.length(); i ++ )
-			currentProperty[i] = toupper(currentProperty[i]);
-		
-		levelFile.ignore(3);
+	vector<ObstacleData> obstacles;
+	LevelFile::readObstacles(levelFile, obstacles);
+	
+	allObstacles_ = new Obstacle[obstacles.size()];
+	
+	for ( int i = 0; i < int(obstacles.size()); i ++ ) {
+		const ObstacleData& obstacle = obstacles[i];
 		
-		if ( currentProperty == "IMAGEFILENAME" ) {
-			getline(levelFile, imageFileName);
-			endBits += exp2(0);
-		}
-		else if ( currentProperty == "POSITION" ) {
-			levelFile >> initPosition[0] >> initPosition[1];
-			endBits += exp2(1);
-		}
-		else if ( currentProperty == "WIDTH" ) {
-			levelFile >> initWidth;
-			endBits += exp2(2);
-		}
-		else if ( currentProperty == "HEIGHT" ) {
-			levelFile >> initHeight;
-			endBits += exp2(3);
-		}
+		if ( obstacle.isRead )
+			allObstacles_[i] = Obstacle(obstacle.imageFilename,
+			                            obstacle.position, obstacle.width,
+			                            obstacle.height);
 	}
-	
-	allObstacles_[obstacleIndex] = Obstacle(imageFileName, initPosition,
-	                                        initWidth, initHeight);
 }
 
 
+// The panel is a single blit, unless its values changed since it was last
+// drawn.
 void ActiveLevel::applyUi ( )
 {
-	SDL_Rect* panelRect = new SDL_Rect;
-	*panelRect = {0, 0, SCREEN_WIDTH, PANEL_HEIGHT};
-	SDL_FillRect(screen, panelRect, SDL_MapRGB(screen->format, 10, 10, 10));
-	
-	Sdl::applyText("HP" + string(player_.getHealth(), '|'), uiFont_,
-	               screen, 20, 20, {255, 10, 10});
-	Sdl::applyText("AP" + string(player_.getArmor(), '|'), uiFont_,
-	               screen, 220, 20, {0, 100, 255});
-	Sdl::applyText("SP" + string(player_.getStamina(), '|'), uiFont_,
-	               screen, 420, 20, {10, 255, 10});
+	dirtyRegions_.add(hudPanel_.apply(screen));
 }
 
 
+// Only the part of the floor inside the viewport is drawn.
 void ActiveLevel::applyBackground ( )
 {
-	SDL_Rect clip = {player_.getPosition()[0] - SCREEN_WIDTH / 2,
-	                 player_.getPosition()[1] - (SCREEN_HEIGHT + PANEL_HEIGHT)
-	                 / 2, SCREEN_WIDTH, SCREEN_HEIGHT};
-	
-	Sdl::applySurface(floorImage_, screen, 0, 0, &clip);
+	renderQueue_.submit(floorImage_.getSurface(), 0, 0, NULL, LAYER_FLOOR);
 }
 
 //}
@@ -18,6 +18,9 @@ using namespace std;
 #include <string>
 #include <sstream>
 #include <initializer_list>
+#include <vector>
+#include <thread>
+#include <atomic>
 
 #include "MathParser.hpp"  // To read numbers as fractions in input stream.
 #include "LinearAlgebra_Errors.hpp"  // Exception handler.
@@ -29,7 +32,14 @@ using namespace std;
 
 //{ Constants
 
-enum MatrixType {IDENTITY, SCALAR, DIAGONAL, TRIANGULAR_UP, TRIANGULAR_DOWN};
+// Every type but DENSE only stores its meaningful elements (none for IDENTITY,
+// one for SCALAR, the diagonal for DIAGONAL and the packed triangle for the
+// triangular types). A structured matrix is promoted to DENSE when one of its
+// structural zeros may be written.
+enum MatrixType {IDENTITY, SCALAR, DIAGONAL, TRIANGULAR_UP, TRIANGULAR_DOWN,
+                 DENSE};
+
+enum MatrixNorm {NORM_ONE, NORM_INFINITY, NORM_FROBENIUS};
 
 //}
 
@@ -37,12 +47,17 @@ enum MatrixType {IDENTITY, SCALAR, DIAGONAL, TRIANGULAR_UP, TRIANGULAR_DOWN};
 //{ Classes
 
 // Forward declarations
-class Matrix; class Vector;
+class Matrix; class Vector; struct LuFactors;
 
 
 class Matrix
 {
 public:
+	// Static attributes
+	static int strassenCrossover;  // Order under which Strassen stops (0: off).
+	static int strassenThreads;    // Threads used for the top level products.
+	static ExpressionCache* readCache;  // Used by read() when not NULL.
+	
   // Constructors and destructor
 	Matrix ( );
 	Matrix ( int, int, double = 0.0 );
@@ -55,34 +70,82 @@ public:
 	
 	// Modifying methods
 	void read ( istream& );
+	void readParallel ( istream&, int = 0 );
 	void fill ( double );
 	void resize ( int, int );
 	void transpose ( );
 	void inverse ( );
 	void gaussElimination ( );
+	void setElement ( int, int, double );
+	void makeDense ( );
+	void enableCache ( bool = true );
 	
 	// Non-modifying methods
-	   int getHeight ( );
-	   int getWidth ( );
-	  void print ( ostream& );
+	       int getHeight ( ) const;
+	       int getWidth ( ) const;
+	MatrixType getType ( ) const;
+	    double element ( int, int ) const;
+	      void print ( ostream& );
 	Matrix submatrix ( int, int );
 	Matrix cofactors ( );
 	double ruleOfSarrus ( );
 	double determinant ( );
 	double trace ( );
+	double norm ( MatrixNorm = NORM_FROBENIUS );
+	Matrix getInverse ( ) const;
+	LuFactors luDecomposition ( ) const;
+	Matrix strassenProduct ( const Matrix& ) const;
+	Vector solve ( const Vector& ) const;
+	
+	// Element of a writable row. It is read through element() and written
+	// through setElement(), so that the cache is emptied and a structured
+	// matrix promoted only when a write changes the element.
+	class Element
+	{
+	public:
+		Element ( Matrix*, int, int );
+		
+		operator double ( ) const;
+		
+		Element& operator = ( double );
+		Element& operator = ( const Element& );
+		Element& operator += ( double );
+		Element& operator -= ( double );
+		Element& operator *= ( double );
+		Element& operator /= ( double );
+	
+	protected:
+		Matrix* matrix_;
+		    int row_;
+		    int column_;
+	};
 	
 	// Proxy class used to check subscript errors with matrix operator [].
 	class Proxy
 	{
 	public:
-		Proxy ( double*, int );
+		Proxy ( Matrix*, int );
 		
-		double& operator [] ( int );
+		Element operator [] ( int );
 		 double operator [] ( int ) const;
 	
 	protected:
-		    int width_;
-		double* row_;
+		Matrix* matrix_;
+		    int row_;
+	};
+	
+	// Read-only proxy, which also reads the structural zeros of a structured
+	// matrix without promoting it.
+	class ConstProxy
+	{
+	public:
+		ConstProxy ( const Matrix*, int );
+		
+		double operator [] ( int ) const;
+	
+	protected:
+		const Matrix* matrix_;
+		          int row_;
 	};
 	
 	// Modifying operators
@@ -96,8 +159,8 @@ public:
 	Matrix& operator /= ( double );
 	
 	// Non-modifying operators
-	 Proxy operator [] ( int ) const;
-	  bool operator == ( const Matrix& ) const;
+	ConstProxy operator [] ( int ) const;
+	      bool operator == ( const Matrix& ) const;
 	  bool operator != ( const Matrix& ) const;
 	Matrix operator - ( ) const;
 	Matrix operator + ( const Matrix& ) const;
@@ -105,13 +168,67 @@ public:
 	Matrix operator * ( const Matrix& ) const;
 	Matrix operator * ( double ) const;
 	Matrix operator / ( double ) const;
+	
+	// In place functions
+	friend void scale ( Matrix&, double );
+	friend void add ( const Matrix&, const Matrix&, Matrix& );
+	friend void sub ( const Matrix&, const Matrix&, Matrix& );
+	friend void gemm ( double, const Matrix&, const Matrix&, double, Matrix& );
 
 
 protected:
+	// Derived quantities kept between calls once enableCache() is called. Every
+	// modification of the matrix empties the cache.
+	struct Cache
+	{
+		      bool hasDeterminant;
+		    double determinant;
+		      bool hasTrace;
+		    double trace;
+		      bool hasNorms;
+		    double norms[3];
+		   Matrix* inverse;
+		LuFactors* lowerUpper;
+	};
+	
+	// Cache methods
+	void invalidate ( );
+	void copyCache ( const Matrix& );
+	const LuFactors& factors ( LuFactors& ) const;
+	static Vector substitute ( const LuFactors&, const Vector& );
+	
+	// Storage methods
+	   void invertStructured ( );
+	   void release ( );
+	   void allocate ( int, int );
+	    int storedCount ( ) const;
+	   void storedColumns ( int, int&, int& ) const;
+	double* storedElement ( int, int ) const;
+	 Matrix structuredProduct ( const Matrix& ) const;
+	
+	static MatrixType sumType ( MatrixType, MatrixType );
+	
 	// Attributes
-	     int height_;
-	     int width_;
-	double** array_;
+	       int height_;
+	       int width_;
+	  double** array_;   // Rows of a DENSE matrix, NULL otherwise.
+	MatrixType type_;
+	   double* packed_;  // Stored elements of a structured matrix.
+	    Cache* cache_;   // NULL unless enableCache() was called.
+};
+int Matrix::strassenCrossover = 0;
+int Matrix::strassenThreads = 1;
+ExpressionCache* Matrix::readCache = NULL;
+
+
+// Factors of PA = LU from Gaussian elimination with partial pivoting. The unit
+// lower triangle L is stored under the diagonal of 'packed', U on and above it.
+struct LuFactors
+{
+	     Matrix packed;
+	vector<int> permutation;  // Row of A found at every row of the factors.
+	        int sign;         // Sign of the permutation.
+	       bool isSingular;
 };
 
 
@@ -154,6 +271,12 @@ public:
 	Vector operator - ( const Vector& ) const;
 	Vector operator * ( double ) const;
 	Vector operator / ( double ) const;
+	
+	// In place functions
+	friend void axpy ( double, const Vector&, Vector& );
+	friend void scale ( Vector&, double );
+	friend void add ( const Vector&, const Vector&, Vector& );
+	friend void sub ( const Vector&, const Vector&, Vector& );
 
 protected:
 	// Attributes
@@ -184,6 +307,51 @@ double scalarProduct ( const Vector&, const Vector& );
 
 Vector crossProduct ( const Vector&, const Vector& );
 
+// In place forms : the result is written into the last (or only) matrix or
+// vector argument, whose dimensions must already match.
+void axpy ( double, const Vector&, Vector& );
+
+void scale ( Matrix&, double );
+
+void scale ( Vector&, double );
+
+void add ( const Matrix&, const Matrix&, Matrix& );
+
+void add ( const Vector&, const Vector&, Vector& );
+
+void sub ( const Matrix&, const Matrix&, Matrix& );
+
+void sub ( const Vector&, const Vector&, Vector& );
+
+void gemm ( double, const Matrix&, const Matrix&, double, Matrix& );
+
+//}
+
+
+//{ Strassen-Winograd
+
+// Kernels working on square row-major blocks of contiguous storage. A block is
+// addressed by its first element and the stride between two of its rows.
+namespace Strassen
+{
+	struct Block
+	{
+		double* data;
+		    int stride;
+		
+		double* row ( int i ) const { return data + i * stride; }
+		  Block quadrant ( int, int, int ) const;
+	};
+	
+	int paddedOrder ( int, int );
+	
+	void add ( Block, Block, Block, int );
+	void subtract ( Block, Block, Block, int );
+	void classicalProduct ( Block, Block, Block, int );
+	void product ( Block, Block, Block, int, int, double* );
+	void parallelProduct ( Block, Block, Block, int, int, int );
+}
+
 //}
 
 //}
@@ -197,26 +365,27 @@ Vector crossProduct ( const Vector&, const Vector& );
 
 Matrix::Matrix ( )
 {
+	cache_ = NULL;
+	
 	height_ = 0;
 	width_ = 0;
 	
 	array_ = NULL;
+	type_ = DENSE;
+	packed_ = NULL;
 }
 
 
 Matrix::Matrix ( int initHeight, int initWidth, double initValue )
 {
+	cache_ = NULL;
+	
 	if ( initHeight <= 0 )
 		throw LinAlgError(MatErr::HEIGHT);
 	if ( initWidth <= 0 )
 		throw LinAlgError(MatErr::WIDTH);
 	
-	height_ = initHeight;
-	width_ = initWidth;
-	
-	array_ = new double*[height_];
-	for ( int i = 0; i < height_; i ++ ) 
-		array_[i] = new double[width_];
+	(*this).allocate(initHeight, initWidth);
 	
 	(*this).fill(initValue);
 }
@@ -224,47 +393,36 @@ Matrix::Matrix ( int initHeight, int initWidth, double initValue )
 
 Matrix::Matrix ( int initOrder, MatrixType type, double initValue )
 {
+	cache_ = NULL;
+	
 	if ( initOrder <= 0 )
 		throw LinAlgError(MatErr::HEIGHT);
 	
-	height_ = width_ = initOrder;
-	
-	array_ = new double*[height_];
-	for ( int i = 0; i < height_; i ++ )
-		array_[i] = new double[width_];
-	
-	for ( int i = 0; i < height_; i ++ )
-		for ( int j = 0; j < width_; j ++ )
-			array_[i][j] = 0.0;
-	
-	if ( type == IDENTITY )
-		for ( int i = 0; i < height_; i ++ )
-			array_[i][i] = 1.0;
-	
-	if ( type == SCALAR )
-		for ( int i = 0; i < height_; i ++ )
-			array_[i][i] = initValue;
-	
-	if ( type == TRIANGULAR_UP )
-		for ( int i = 0; i < height_; i ++ )
-			for ( int j = i; j < width_; j ++ )
-				array_[i][j] = initValue;
-	
-	if ( type == TRIANGULAR_DOWN )
-		for ( int i = 0; i < height_; i ++ )
-			for ( int j = 0; j <= i; j ++ )
-				array_[i][j] = initValue;
+	if ( type == DENSE ) {
+		(*this).allocate(initOrder, initOrder);
+		(*this).fill(initValue);
+	}
+	else {
+		height_ = width_ = initOrder;
+		
+		array_ = NULL;
+		type_ = type;
+		packed_ = NULL;
+		
+		if ( (*this).storedCount() > 0 )
+			packed_ = new double[(*this).storedCount()];
+		
+		for ( int k = 0; k < (*this).storedCount(); k ++ )
+			packed_[k] = initValue;
+	}
 }
 
 
 Matrix::Matrix ( initializer_list<initializer_list<double>> initValuesList )
 {
-	height_ = initValuesList.size();
-	width_ = initValuesList.begin()->size();
+	cache_ = NULL;
 	
-	array_ = new double*[height_];
-	for ( int i = 0; i < height_; i ++ ) 
-		array_[i] = new double[width_];
+	(*this).allocate(initValuesList.size(), initValuesList.begin()->size());
 	
 	int i = 0;
 	for ( initializer_list<double> row : initValuesList) {
@@ -282,27 +440,38 @@ Matrix::Matrix ( initializer_list<initializer_list<double>> initValuesList )
 
 Matrix::Matrix ( const Matrix& model )
 {
+	cache_ = NULL;
+	
 	height_ = model.height_;
 	width_ = model.width_;
 	
-	array_ = new double*[height_];
-	for ( int i = 0; i < height_; i ++ ) 
-		array_[i] = new double[width_];
+	array_ = NULL;
+	type_ = model.type_;
+	packed_ = NULL;
 	
-	for ( int i = 0; i < height_; i ++ )
-		for ( int j = 0; j < width_; j ++ )
-			array_[i][j] = model.array_[i][j];
+	if ( type_ == DENSE ) {
+		(*this).allocate(height_, width_);
+		
+		for ( int i = 0; i < height_; i ++ )
+			for ( int j = 0; j < width_; j ++ )
+				array_[i][j] = model.array_[i][j];
+	}
+	else if ( (*this).storedCount() > 0 ) {
+		packed_ = new double[(*this).storedCount()];
+		
+		for ( int k = 0; k < (*this).storedCount(); k ++ )
+			packed_[k] = model.packed_[k];
+	}
+	
+	(*this).copyCache(model);
 }
 
 
 Matrix::Matrix ( const Vector& modelVector )
 {
-	height_ = modelVector.getDimension();
-	width_ = 1;
+	cache_ = NULL;
 	
-	array_ = new double*[height_];
-	for ( int i = 0; i < height_; i ++ )
-		array_[i] = new double;
+	(*this).allocate(modelVector.getDimension(), 1);
 	
 	for ( int i = 0; i < height_; i ++ )
 		array_[i][0] = modelVector[i];
@@ -311,17 +480,14 @@ Matrix::Matrix ( const Vector& modelVector )
 
 Matrix::Matrix ( initializer_list<Vector> initVectorsList )
 {
+	cache_ = NULL;
+	
 	int matrixHeight = initVectorsList.begin()->getDimension();
 	for ( Vector columnVector : initVectorsList )
 		if ( columnVector.getDimension() != matrixHeight )
 			throw LinAlgError(MatErr::VECTORS_DIMENSIONS);
 	
-	height_ = matrixHeight;
-	width_ = initVectorsList.size();
-	
-	array_ = new double*[height_];
-	for ( int i = 0; i < height_; i ++ )
-		array_[i] = new double[width_];
+	(*this).allocate(matrixHeight, initVectorsList.size());
 	
 	int i = 0;
 	for ( Vector columnVector : initVectorsList ) {
@@ -336,9 +502,8 @@ Matrix::Matrix ( initializer_list<Vector> initVectorsList )
 inline
 Matrix::~Matrix ( )
 {
-	for ( int i = 0; i < height_; i ++ )
-		delete []array_[i];
-	delete []array_;
+	(*this).release();
+	(*this).enableCache(false);
 }
 
 //}
@@ -358,20 +523,128 @@ void Matrix::read ( istream& source )
 	
 	(*this).resize(readHeight, readWidth);
 	
+	// Reused for every element; a failed extraction would leave the last one.
+	string valueExpression;
+	
 	for ( int i = 0; i < height_; i ++ )
 		for ( int j = 0; j < width_; j ++ ) {
-			string valueExpression;
-			source >> valueExpression;
-			(*this)[i][j] = eval(valueExpression);
+			if ( not (source >> valueExpression) )
+				throw ParseError(ParseErr::EMPTY);
+			
+			(*this)[i][j] = readCache != NULL ?
+			                (*readCache).eval(valueExpression) :
+			                eval(valueExpression);
+		}
+}
+
+
+// Same format and header checks as read(), with the elements parsed on
+// several threads (0 : one per core). The rest of the stream is loaded at
+// once, so the matrix must be the last thing in it; readCache is not used.
+void Matrix::readParallel ( istream& source, int threadCount )
+{
+	int readHeight, readWidth;
+	source >> readHeight >> readWidth;
+	
+	if ( readHeight < 0 )
+		throw LinAlgError(MatErr::HEIGHT);
+	if ( readWidth < 0 )
+		throw LinAlgError(MatErr::WIDTH);
+	
+	string text;
+	vector<char> chunk(1 << 20);
+	while ( source.read(chunk.data(), chunk.size()) or source.gcount() > 0 )
+		text.append(chunk.data(), source.gcount());
+	
+	(*this).resize(readHeight, readWidth);
+	
+	if ( threadCount <= 0 )
+		threadCount = max(1, int(thread::hardware_concurrency()));
+	
+	auto inParallel = [threadCount] ( auto task ) {
+		vector<thread> workers;
+		for ( int k = 1; k < threadCount; k ++ )
+			workers.push_back(thread(task, k));
+		task(0);
+		for ( thread& runningWorker : workers )
+			runningWorker.join();
+	};
+	
+	// Every part starts on a blank, so that no element is split.
+	vector<size_t> bounds(threadCount + 1, text.size());
+	bounds[0] = 0;
+	for ( int k = 1; k < threadCount; k ++ ) {
+		size_t bound = max(text.size() / threadCount * k, bounds[k - 1]);
+		while ( bound < text.size() and not Parsing::isBlank(text[bound]) )
+			bound++;
+		
+		bounds[k] = bound;
+	}
+	
+	// First pass : elements in every part, hence the index of their first one.
+	vector<size_t> firsts(threadCount + 1, 0);
+	inParallel([&] ( int k ) {
+		size_t count = 0;
+		for ( size_t p = bounds[k]; p < bounds[k + 1]; p ++ )
+			if (
+				not Parsing::isBlank(text[p]) and
+				( p == bounds[k] or Parsing::isBlank(text[p - 1]) ) )
+				count++;
+		
+		firsts[k + 1] = count;
+	});
+	
+	for ( int k = 0; k < threadCount; k ++ )
+		firsts[k + 1] += firsts[k];
+	
+	size_t elementCount = size_t(height_) * width_;
+	if ( firsts[threadCount] < elementCount )
+		throw ParseError(ParseErr::EMPTY);
+	
+	// Second pass : every part writes its elements in place.
+	vector<ParseErr::Code> errors(threadCount, ParseErr::NONE);
+	inParallel([&] ( int k ) {
+		size_t index = firsts[k];
+		size_t p = bounds[k];
+		
+		while ( index < elementCount and errors[k] == ParseErr::NONE ) {
+			while ( p < bounds[k + 1] and Parsing::isBlank(text[p]) )
+				p++;
+			if ( p == bounds[k + 1] )
+				break;
+			
+			size_t end = p;
+			while ( end < bounds[k + 1] and not Parsing::isBlank(text[end]) )
+				end++;
+			
+			errors[k] = eval(string_view(&text[p], end - p),
+			                 array_[index / width_][index % width_]);
+			
+			index++;
+			p = end;
 		}
+	});
+	
+	for ( int k = 0; k < threadCount; k ++ )
+		if ( errors[k] != ParseErr::NONE )
+			throw ParseError(errors[k]);
 }
 
 
+// Writes the dense storage directly, which may be uninitialised as after
+// allocate(). A structured matrix is made DENSE.
 void Matrix::fill ( double value )
 {
+	(*this).invalidate();
+	
+	if ( type_ != DENSE ) {
+		(*this).release();
+		(*this).allocate(height_, width_);
+	}
+	
 	for ( int i = 0; i < height_; i ++ )
 		for ( int j = 0; j < width_; j ++ )
-			(*this)[i][j] = value;
+			array_[i][j] = value;
 }
 
 
@@ -382,61 +655,59 @@ void Matrix::resize ( int newHeight, int newWidth )
 	if ( newWidth <= 0 )
 		throw LinAlgError(MatErr::WIDTH);
 	
-	Matrix buffer(*this);
-	
-	for ( int i = 0; i < height_; i ++ )
-		delete []array_[i];
-	delete []array_;
+	(*this).invalidate();
 	
-	height_ = newHeight;
-	width_ = newWidth;
+	Matrix buffer(*this);
 	
-	array_ = new double*[height_];
-	for ( int i = 0; i < height_; i ++ )
-		array_[i] = new double[width_];
+	(*this).release();
+	(*this).allocate(newHeight, newWidth);
 	
 	(*this).fill(0.0);
 	
 	for ( int i = 0; i < height_ and i < buffer.height_; i ++ )
 		for ( int j = 0; j < width_ and j < buffer.width_; j ++ )
-			(*this)[i][j] = buffer[i][j];
+			array_[i][j] = buffer.element(i, j);
 }
 
 
 void Matrix::transpose ( )
 {
-	Matrix buffer(*this);
+	(*this).invalidate();
 	
-	for ( int i = 0; i < height_; i ++ )
-		delete []array_[i];
-	delete []array_;
+	// The diagonal types are symmetric and the triangular ones swap their
+	// orientation, without leaving the packed storage.
+	if ( type_ == TRIANGULAR_UP or type_ == TRIANGULAR_DOWN ) {
+		Matrix transposed(height_, type_ == TRIANGULAR_UP ? TRIANGULAR_DOWN
+		                                                  : TRIANGULAR_UP);
+		
+		for ( int i = 0; i < height_; i ++ ) {
+			int first, last;
+			(*this).storedColumns(i, first, last);
+			
+			for ( int j = first; j < last; j ++ )
+				*transposed.storedElement(j, i) = *(*this).storedElement(i, j);
+		}
+		
+		*this = transposed;
+	}
 	
-	height_ = buffer.width_;
-	width_ = buffer.height_;
+	if ( type_ != DENSE )
+		return;
 	
-	array_ = new double*[height_];
-	for ( int i = 0; i < height_; i ++ )
-		array_[i] = new double[width_];
+	Matrix buffer(*this);
+	
+	(*this).release();
+	(*this).allocate(buffer.width_, buffer.height_);
 	
 	for ( int i = 0; i < height_; i ++ )
 		for ( int j = 0; j < width_; j ++ )
-			(*this)[i][j] = buffer[j][i];
+			array_[i][j] = buffer.array_[j][i];
 }
 
 
 void Matrix::inverse ( )
 {
-	if ( height_ != width_ )
-		throw LinAlgError(MatErr::NOT_SQUARE);
-	
-	double determinant = (*this).determinant();
-	
-	if ( determinant == 0.0 )
-		throw LinAlgError(MatErr::SINGULAR);
-	
-	*this = (*this).cofactors();
-	(*this).transpose();
-	(*this) *= (1.0 / determinant);
+	*this = (*this).getInverse();
 }
 
 
@@ -457,32 +728,118 @@ void Matrix::gaussElimination ( )
 		}
 }
 
+
+// Writes an element without promoting a structured matrix, unless it changes a
+// structural zero or the shared diagonal of an IDENTITY or SCALAR matrix. The
+// matrix must be initialised : an unchanged element is not written.
+void Matrix::setElement ( int row, int column, double value )
+{
+	if ( (*this).element(row, column) == value )
+		return;
+	
+	(*this).invalidate();
+	
+	double* stored = (*this).storedElement(row, column);
+	
+	if ( stored != NULL and type_ != SCALAR )
+		*stored = value;
+	else {
+		(*this).makeDense();
+		array_[row][column] = value;
+	}
+}
+
+
+void Matrix::makeDense ( )
+{
+	if ( type_ == DENSE )
+		return;
+	
+	double** rows = new double*[height_];
+	for ( int i = 0; i < height_; i ++ ) {
+		rows[i] = new double[width_];
+		
+		for ( int j = 0; j < width_; j ++ )
+			rows[i][j] = (*this).element(i, j);
+	}
+	
+	delete []packed_;
+	packed_ = NULL;
+	
+	array_ = rows;
+	type_ = DENSE;
+}
+
+
+void Matrix::enableCache ( bool isEnabled )
+{
+	if ( isEnabled and cache_ == NULL ) {
+		cache_ = new Cache;
+		cache_->inverse = NULL;
+		cache_->lowerUpper = NULL;
+		
+		(*this).invalidate();
+	}
+	else if ( not isEnabled and cache_ != NULL ) {
+		(*this).invalidate();
+		
+		delete cache_;
+		cache_ = NULL;
+	}
+}
+
 //}
 
 
 //{ Matrix::Non-modifying methods
 
 inline
-int Matrix::getHeight ( )
+int Matrix::getHeight ( ) const
 {
 	return height_;
 }
 
 
 inline
-int Matrix::getWidth ( )
+int Matrix::getWidth ( ) const
 {
 	return width_;
 }
 
 
+inline
+MatrixType Matrix::getType ( ) const
+{
+	return type_;
+}
+
+
+inline
+double Matrix::element ( int row, int column ) const
+{
+	if ( row >= height_ or row < 0 )
+		throw LinAlgError(MatErr::ROW);
+	if ( column >= width_ or column < 0 )
+		throw LinAlgError(MatErr::COLUMN);
+	
+	if ( type_ == DENSE )
+		return array_[row][column];
+	if ( type_ == IDENTITY )
+		return row == column ? 1.0 : 0.0;
+	
+	double* stored = (*this).storedElement(row, column);
+	
+	return stored != NULL ? *stored : 0.0;
+}
+
+
 void Matrix::print ( ostream& destination )
 {
 	int maxLength = 0;
 	for ( int i = 0; i < height_; i ++ )
 		for ( int j = 0; j < width_; j ++ ) {
 			stringstream buffer;
-			buffer << (*this)[i][j];
+			buffer << (*this).element(i, j);
 			
 			if ( int(buffer.str().size()) > maxLength)
 				maxLength = buffer.str().size();
@@ -492,7 +849,7 @@ void Matrix::print ( ostream& destination )
 	
 	for ( int i = 0; i < height_; i ++ ) {
 		for ( int j = 0; j < width_; j ++ )
-			destination << setw(maxLength + 1) << (*this)[i][j];
+			destination << setw(maxLength + 1) << (*this).element(i, j);
 		
 		destination << "\n";
 	}
@@ -512,16 +869,16 @@ Matrix Matrix::submatrix ( int row, int column )
 		if ( i >= row )
 			for ( int j = 0; j < submatrix.width_; j ++ ) {
 				if ( j >= column )
-					submatrix[i][j] = (*this)[i + 1][j + 1];
+					submatrix[i][j] = (*this).element(i + 1, j + 1);
 				else
-					submatrix[i][j] = (*this)[i + 1][j];
+					submatrix[i][j] = (*this).element(i + 1, j);
 			}
 		else
 			for ( int j = 0; j < submatrix.width_; j ++ ) {
 				if ( j >= column )
-					submatrix[i][j] = (*this)[i][j + 1];
+					submatrix[i][j] = (*this).element(i, j + 1);
 				else
-					submatrix[i][j] = (*this)[i][j];
+					submatrix[i][j] = (*this).element(i, j);
 			}
 	}
 	
@@ -554,7 +911,7 @@ double Matrix::ruleOfSarrus ( )
 	for ( int k = 0; k < 3; k ++ ) {
 		double term = 1;
 		for ( int i = 0, j = k; i < 3; i ++, j ++ )
-			term *= (*this)[i][j % 3];
+			term *= (*this).element(i, j % 3);
 		
 		result += term;
 	}
@@ -562,7 +919,7 @@ double Matrix::ruleOfSarrus ( )
 	for ( int k = 0; k < 3; k ++ ) {
 		double term = 1;
 		for ( int i = 2, j = k; i >= 0; i --, j ++ )
-			term *= (*this)[i][j % 3];
+			term *= (*this).element(i, j % 3);
 		
 		result -= term;
 	}
@@ -576,23 +933,43 @@ double Matrix::determinant ( )
 	if ( height_ != width_ )
 		throw LinAlgError(MatErr::NOT_SQUARE);
 	
+	if ( cache_ != NULL and cache_->hasDeterminant )
+		return cache_->determinant;
+	
 	double result = 1.0;
 	
-	if ( width_ == 1 )
-		result = (*this)[0][0];
+	// Structured matrices only need the product of their diagonal.
+	if ( type_ == IDENTITY )
+		result = 1.0;
+	
+	else if ( type_ == SCALAR )
+		result = pow(packed_[0], height_);
+	
+	else if ( type_ != DENSE )
+		for ( int i = 0; i < height_; i ++ )
+			result *= *(*this).storedElement(i, i);
+	
+	else if ( width_ == 1 )
+		result = array_[0][0];
 	
 	else if ( width_ == 2 )
-		result = (*this)[0][0] * (*this)[1][1] - (*this)[1][0] * (*this)[0][1];
+		result = array_[0][0] * array_[1][1] - array_[1][0] * array_[0][1];
 	
 	else if ( width_ == 3 )
 		result = (*this).ruleOfSarrus();
 	
 	else {
-		Matrix echelon(*this);
-		echelon.gaussElimination();
+		LuFactors buffer;
+		const LuFactors& lowerUpper = (*this).factors(buffer);
 		
+		result = lowerUpper.sign;
 		for ( int i = 0; i < height_; i ++ )
-			result *= echelon[i][i];
+			result *= lowerUpper.packed.array_[i][i];
+	}
+	
+	if ( cache_ != NULL ) {
+		cache_->determinant = result;
+		cache_->hasDeterminant = true;
 	}
 
 	return result;
@@ -604,79 +981,423 @@ double Matrix::trace ( )
 	if ( height_ != width_ )
 		throw LinAlgError(MatErr::NOT_SQUARE);
 	
+	if ( cache_ != NULL and cache_->hasTrace )
+		return cache_->trace;
+	
 	double trace = 0.0;
 	
 	for ( int i = 0; i < height_; i ++ )
-		trace += (*this)[i][i];
+		trace += (*this).element(i, i);
+	
+	if ( cache_ != NULL ) {
+		cache_->trace = trace;
+		cache_->hasTrace = true;
+	}
 	
 	return trace;
 }
 
-//}
-
-
-//{ Matrix::Proxy
-
-inline
-Matrix::Proxy::Proxy ( double* matrixRow, int width )
-{
-	row_ = matrixRow;
-	width_ = width;
-}
-
 
-inline
-double& Matrix::Proxy::operator [] ( int column )
+// The three norms are computed together, in a single pass over the stored
+// elements.
+double Matrix::norm ( MatrixNorm type )
 {
-	if ( column >= width_ or column < 0 )
-		throw LinAlgError(MatErr::COLUMN);
+	if ( cache_ != NULL and cache_->hasNorms )
+		return cache_->norms[type];
+	
+	vector<double> columnSums(width_, 0.0);
+	double norms[3] = {0.0, 0.0, 0.0};
+	
+	for ( int i = 0; i < height_; i ++ ) {
+		double rowSum = 0.0;
+		
+		int first, last;
+		(*this).storedColumns(i, first, last);
+		if ( type_ == IDENTITY ) {
+			first = i;
+			last = i + 1;
+		}
+		
+		for ( int j = first; j < last; j ++ ) {
+			double value = (*this).element(i, j);
+			
+			rowSum += abs(value);
+			columnSums[j] += abs(value);
+			norms[NORM_FROBENIUS] += value * value;
+		}
+		
+		if ( rowSum > norms[NORM_INFINITY] )
+			norms[NORM_INFINITY] = rowSum;
+	}
+	
+	for ( int j = 0; j < width_; j ++ )
+		if ( columnSums[j] > norms[NORM_ONE] )
+			norms[NORM_ONE] = columnSums[j];
+	
+	norms[NORM_FROBENIUS] = sqrt(norms[NORM_FROBENIUS]);
 	
-	return row_[column];
+	if ( cache_ != NULL ) {
+		for ( int k = 0; k < 3; k ++ )
+			cache_->norms[k] = norms[k];
+		cache_->hasNorms = true;
+	}
+	
+	return norms[type];
 }
 
 
-inline
-double Matrix::Proxy::operator [] ( int column ) const
+Matrix Matrix::getInverse ( ) const
 {
-	if ( column >= width_ or column < 0 )
-		throw LinAlgError(MatErr::COLUMN);
+	if ( height_ != width_ )
+		throw LinAlgError(MatErr::NOT_SQUARE);
 	
-	return row_[column];
-}
-
-//}
-
+	if ( cache_ != NULL and cache_->inverse != NULL )
+		return *cache_->inverse;
+	
+	Matrix inverse;
+	
+	// Dense matrices are inverted column by column from their LU factors.
+	if ( type_ == DENSE ) {
+		LuFactors buffer;
+		const LuFactors& lowerUpper = (*this).factors(buffer);
+		
+		if ( lowerUpper.isSingular )
+			throw LinAlgError(MatErr::SINGULAR);
+		
+		inverse = Matrix(height_, width_);
+		
+		for ( int j = 0; j < width_; j ++ ) {
+			Vector unit(height_, 0.0);
+			unit[j] = 1.0;
+			
+			Vector column = substitute(lowerUpper, unit);
+			
+			for ( int i = 0; i < height_; i ++ )
+				inverse.array_[i][j] = column[i];
+		}
+	}
+	else {
+		inverse = *this;
+		inverse.invertStructured();
+	}
+	
+	if ( cache_ != NULL )
+		cache_->inverse = new Matrix(inverse);
+	
+	return inverse;
+}
+
+
+LuFactors Matrix::luDecomposition ( ) const
+{
+	if ( height_ != width_ )
+		throw LinAlgError(MatErr::NOT_SQUARE);
+	
+	LuFactors lowerUpper;
+	lowerUpper.packed = *this;
+	lowerUpper.packed.makeDense();
+	lowerUpper.sign = 1;
+	lowerUpper.isSingular = false;
+	
+	lowerUpper.permutation.resize(height_);
+	for ( int i = 0; i < height_; i ++ )
+		lowerUpper.permutation[i] = i;
+	
+	double** rows = lowerUpper.packed.array_;
+	
+	for ( int j = 0; j < width_; j ++ ) {
+		int pivotRow = j;
+		for ( int i = j + 1; i < height_; i ++ )
+			if ( abs(rows[i][j]) > abs(rows[pivotRow][j]) )
+				pivotRow = i;
+		
+		if ( rows[pivotRow][j] == 0.0 ) {
+			lowerUpper.isSingular = true;
+			continue;
+		}
+		
+		if ( pivotRow != j ) {
+			swap(rows[j], rows[pivotRow]);
+			swap(lowerUpper.permutation[j], lowerUpper.permutation[pivotRow]);
+			lowerUpper.sign = -lowerUpper.sign;
+		}
+		
+		for ( int i = j + 1; i < height_; i ++ ) {
+			rows[i][j] /= rows[j][j];
+			
+			for ( int k = j + 1; k < width_; k ++ )
+				rows[i][k] -= rows[i][j] * rows[j][k];
+		}
+	}
+	
+	return lowerUpper;
+}
+
+
+Matrix Matrix::strassenProduct ( const Matrix& rightTerm ) const
+{
+	if ( height_ != width_ or rightTerm.height_ != rightTerm.width_ )
+		throw LinAlgError(MatErr::NOT_SQUARE);
+	if ( width_ != rightTerm.height_ )
+		throw LinAlgError(MatErr::INCOMPATIBLE);
+	
+	if ( type_ != DENSE or rightTerm.type_ != DENSE ) {
+		Matrix left(*this), right(rightTerm);
+		left.makeDense();
+		right.makeDense();
+		
+		return left.strassenProduct(right);
+	}
+	
+	int crossover = strassenCrossover > 0 ? strassenCrossover : 64;
+	int order = Strassen::paddedOrder(width_, crossover);
+	
+	// The operands are copied once into zero padded contiguous buffers so that
+	// every recursion level splits into four equal quadrants.
+	vector<double> left(size_t(order) * order, 0.0);
+	vector<double> right(size_t(order) * order, 0.0);
+	vector<double> result(size_t(order) * order);
+	
+	for ( int i = 0; i < height_; i ++ )
+		for ( int j = 0; j < width_; j ++ ) {
+			left[size_t(i) * order + j] = array_[i][j];
+			right[size_t(i) * order + j] = rightTerm.array_[i][j];
+		}
+	
+	Strassen::Block a = {left.data(), order};
+	Strassen::Block b = {right.data(), order};
+	Strassen::Block c = {result.data(), order};
+	
+	if ( strassenThreads > 1 and order > crossover )
+		Strassen::parallelProduct(a, b, c, order, crossover, strassenThreads);
+	else {
+		vector<double> workspace(size_t(order) * order);
+		Strassen::product(a, b, c, order, crossover, workspace.data());
+	}
+	
+	Matrix product(height_, width_);
+	
+	for ( int i = 0; i < height_; i ++ )
+		for ( int j = 0; j < width_; j ++ )
+			product.array_[i][j] = result[size_t(i) * order + j];
+	
+	return product;
+}
+
+
+Vector Matrix::solve ( const Vector& constants ) const
+{
+	if ( height_ != width_ )
+		throw LinAlgError(MatErr::NOT_SQUARE);
+	if ( constants.getDimension() != height_ )
+		throw LinAlgError(MatErr::INCOMPATIBLE);
+	
+	Vector solution(constants);
+	
+	if ( type_ == IDENTITY )
+		return solution;
+	
+	if ( type_ == SCALAR or type_ == DIAGONAL ) {
+		for ( int i = 0; i < height_; i ++ ) {
+			double pivot = *(*this).storedElement(i, i);
+			if ( pivot == 0.0 )
+				throw LinAlgError(MatErr::SINGULAR);
+			
+			solution[i] /= pivot;
+		}
+	}
+	
+	else if ( type_ == TRIANGULAR_DOWN ) {
+		for ( int i = 0; i < height_; i ++ ) {
+			double pivot = *(*this).storedElement(i, i);
+			if ( pivot == 0.0 )
+				throw LinAlgError(MatErr::SINGULAR);
+			
+			for ( int k = 0; k < i; k ++ )
+				solution[i] -= *(*this).storedElement(i, k) * solution[k];
+			
+			solution[i] /= pivot;
+		}
+	}
+	
+	else if ( type_ == TRIANGULAR_UP ) {
+		for ( int i = height_ - 1; i >= 0; i -- ) {
+			double pivot = *(*this).storedElement(i, i);
+			if ( pivot == 0.0 )
+				throw LinAlgError(MatErr::SINGULAR);
+			
+			for ( int k = i + 1; k < width_; k ++ )
+				solution[i] -= *(*this).storedElement(i, k) * solution[k];
+			
+			solution[i] /= pivot;
+		}
+	}
+	
+	else {
+		LuFactors buffer;
+		const LuFactors& lowerUpper = (*this).factors(buffer);
+		
+		if ( lowerUpper.isSingular )
+			throw LinAlgError(MatErr::SINGULAR);
+		
+		solution = substitute(lowerUpper, constants);
+	}
+	
+	return solution;
+}
+
+//}
+
+
+//{ Matrix::Proxy
+
+inline
+Matrix::Element::Element ( Matrix* matrix, int row, int column )
+{
+	if ( column >= matrix->width_ or column < 0 )
+		throw LinAlgError(MatErr::COLUMN);
+	
+	matrix_ = matrix;
+	row_ = row;
+	column_ = column;
+}
+
+
+inline
+Matrix::Element::operator double ( ) const
+{
+	return matrix_->element(row_, column_);
+}
+
+
+inline
+Matrix::Element& Matrix::Element::operator = ( double value )
+{
+	matrix_->setElement(row_, column_, value);
+	
+	return *this;
+}
+
+
+// Assigns the value of the other element.
+inline
+Matrix::Element& Matrix::Element::operator = ( const Element& model )
+{
+	return *this = double(model);
+}
+
+
+inline
+Matrix::Element& Matrix::Element::operator += ( double value )
+{
+	return *this = double(*this) + value;
+}
+
+
+inline
+Matrix::Element& Matrix::Element::operator -= ( double value )
+{
+	return *this = double(*this) - value;
+}
+
+
+inline
+Matrix::Element& Matrix::Element::operator *= ( double value )
+{
+	return *this = double(*this) * value;
+}
+
+
+inline
+Matrix::Element& Matrix::Element::operator /= ( double value )
+{
+	return *this = double(*this) / value;
+}
+
+
+inline
+Matrix::Proxy::Proxy ( Matrix* matrix, int row )
+{
+	matrix_ = matrix;
+	row_ = row;
+}
+
+
+inline
+Matrix::Element Matrix::Proxy::operator [] ( int column )
+{
+	return Element(matrix_, row_, column);
+}
+
+
+inline
+double Matrix::Proxy::operator [] ( int column ) const
+{
+	return matrix_->element(row_, column);
+}
+
+
+inline
+Matrix::ConstProxy::ConstProxy ( const Matrix* matrix, int row )
+{
+	matrix_ = matrix;
+	row_ = row;
+}
+
+
+inline
+double Matrix::ConstProxy::operator [] ( int column ) const
+{
+	return matrix_->element(row_, column);
+}
+
+//}
+
 
 //{ Matrix::Modifying operators
 
+// Reading an element through the row leaves the matrix as it is; see Element.
 inline
 Matrix::Proxy Matrix::operator [] ( int row )
 {
 	if ( row >= height_ or row < 0 )
 		throw LinAlgError(MatErr::ROW);
 	
-	return Proxy(array_[row], width_);
+	return Proxy(this, row);
 }
 
 
 Matrix& Matrix::operator = ( const Matrix& rightTerm )
 {
-	if ( rightTerm.width_ != width_ or rightTerm.height_ != height_ ) {
-		for ( int i = 0; i < height_; i ++ )
-			delete []array_[i];
-		delete []array_;
-		
-		height_ = rightTerm.height_;
-		width_ = rightTerm.width_;
+	if ( this == &rightTerm )
+		return *this;
+	
+	(*this).invalidate();
+	
+	if (
+	rightTerm.width_ != width_ or rightTerm.height_ != height_ or
+	rightTerm.type_ != type_ ) {
+		(*this).release();
 		
-		array_ = new double*[height_];
-		for ( int i = 0; i < height_; i ++ )
-			array_[i] = new double[width_];
+		if ( rightTerm.type_ == DENSE )
+			(*this).allocate(rightTerm.height_, rightTerm.width_);
+		else {
+			height_ = rightTerm.height_;
+			width_ = rightTerm.width_;
+			type_ = rightTerm.type_;
+			
+			if ( (*this).storedCount() > 0 )
+				packed_ = new double[(*this).storedCount()];
+		}
 	}
 	
-	for ( int i = 0; i < height_; i ++ )
-		for ( int j = 0; j < width_; j ++ )
-			(*this)[i][j] = rightTerm[i][j];
+	if ( type_ == DENSE )
+		for ( int i = 0; i < height_; i ++ )
+			for ( int j = 0; j < width_; j ++ )
+				array_[i][j] = rightTerm.array_[i][j];
+	else
+		for ( int k = 0; k < (*this).storedCount(); k ++ )
+			packed_[k] = rightTerm.packed_[k];
 	
 	return *this;
 }
@@ -687,19 +1408,13 @@ Matrix& Matrix::operator = ( initializer_list<initializer_list<double>>
 {
 	if (
 	int(valuesList.size()) != height_ or
-	int(valuesList.begin()->size()) != width_ ) {
-		for ( int i = 0; i < height_; i ++ )
-			delete []array_[i];
-		delete []array_;
-		
-		height_ = valuesList.size();
-		width_ = valuesList.begin()->size();
-		
-		array_ = new double*[height_];
-		for ( int i = 0; i < height_; i ++ )
-			array_[i] = new double[width_];
+	int(valuesList.begin()->size()) != width_ or type_ != DENSE ) {
+		(*this).release();
+		(*this).allocate(valuesList.size(), valuesList.begin()->size());
 	}
 	
+	(*this).invalidate();
+	
 	int i = 0;
 	for ( initializer_list<double> row : valuesList ) {
 		int j = 0;
@@ -716,12 +1431,10 @@ Matrix& Matrix::operator = ( initializer_list<initializer_list<double>>
 
 Matrix& Matrix::operator += ( const Matrix& rightTerm )
 {
-	if ( height_ != rightTerm.height_ or width_ != rightTerm.width_ )
-		throw LinAlgError(MatErr::INCOMPATIBLE);
-	
-	for ( int i = 0; i < height_; i ++ )
-		for ( int j = 0; j < width_; j ++ )
-			(*this)[i][j] += rightTerm[i][j];
+	if ( type_ != DENSE )
+		*this = *this + rightTerm;
+	else
+		add(*this, rightTerm, *this);
 	
 	return *this;
 }
@@ -729,12 +1442,10 @@ Matrix& Matrix::operator += ( const Matrix& rightTerm )
 
 Matrix& Matrix::operator -= ( const Matrix& rightTerm )
 {
-	if ( height_ != rightTerm.height_ or width_ != rightTerm.width_ )
-		throw LinAlgError(MatErr::INCOMPATIBLE);
-	
-	for ( int i = 0; i < height_; i ++ )
-		for ( int j = 0; j < width_; j ++ )
-			(*this)[i][j] += rightTerm[i][j];
+	if ( type_ != DENSE )
+		*this = *this - rightTerm;
+	else
+		sub(*this, rightTerm, *this);
 	
 	return *this;
 }
@@ -750,9 +1461,7 @@ Matrix& Matrix::operator *= ( const Matrix& rightTerm )
 
 Matrix& Matrix::operator *= ( double rightScalarTerm )
 {
-	for ( int i = 0; i < height_; i ++ )
-		for ( int j = 0; j < width_; j ++ )
-			(*this)[i][j] *= rightScalarTerm;
+	scale(*this, rightScalarTerm);
 	
 	return *this;
 }
@@ -760,9 +1469,19 @@ Matrix& Matrix::operator *= ( double rightScalarTerm )
 
 Matrix& Matrix::operator /= ( double rightScalarTerm )
 {
-	for ( int i = 0; i < height_; i ++ )
-		for ( int j = 0; j < width_; j ++ )
-			(*this)[i][j] /= rightScalarTerm;
+	(*this).invalidate();
+	
+	if ( type_ == IDENTITY )
+		scale(*this, 1.0 / rightScalarTerm);
+	
+	else if ( type_ != DENSE )
+		for ( int k = 0; k < (*this).storedCount(); k ++ )
+			packed_[k] /= rightScalarTerm;
+	
+	else
+		for ( int i = 0; i < height_; i ++ )
+			for ( int j = 0; j < width_; j ++ )
+				array_[i][j] /= rightScalarTerm;
 	
 	return *this;
 }
@@ -773,12 +1492,12 @@ Matrix& Matrix::operator /= ( double rightScalarTerm )
 //{ Matrix::Non-modifying operators
 
 inline
-Matrix::Proxy Matrix::operator [] ( int row ) const
+Matrix::ConstProxy Matrix::operator [] ( int row ) const
 {
 	if ( row >= height_ or row < 0 )
 		throw LinAlgError(MatErr::ROW);
 	
-	return Proxy(array_[row], width_);
+	return ConstProxy(this, row);
 }
 
 
@@ -813,10 +1532,8 @@ Matrix Matrix::operator - ( ) const
 {
 	Matrix opposite(*this);
 	
-	for ( int i = 0; i < opposite.height_; i ++ )
-		for ( int j = 0; j < opposite.width_; j ++ )
-			opposite[i][j] = -opposite[i][j];
-			
+	scale(opposite, -1.0);
+	
 	return opposite;
 }
 
@@ -826,6 +1543,21 @@ Matrix Matrix::operator + ( const Matrix& rightTerm ) const
 	if ( height_ != rightTerm.height_ or width_ != rightTerm.width_ )
 		throw LinAlgError(MatErr::INCOMPATIBLE);
 	
+	if ( type_ != DENSE or rightTerm.type_ != DENSE ) {
+		Matrix sum(height_, sumType(type_, rightTerm.type_));
+		
+		for ( int i = 0; i < height_; i ++ ) {
+			int first, last;
+			sum.storedColumns(i, first, last);
+			
+			for ( int j = first; j < last; j ++ )
+				*sum.storedElement(i, j) = (*this).element(i, j) +
+				                           rightTerm.element(i, j);
+		}
+		
+		return sum;
+	}
+	
 	Matrix sum(height_, width_);
 	
 	for ( int i = 0; i < height_; i ++ )
@@ -841,6 +1573,21 @@ Matrix Matrix::operator - ( const Matrix& rightTerm ) const
 	if ( height_ != rightTerm.height_ or width_ != rightTerm.width_ )
 		throw LinAlgError(MatErr::INCOMPATIBLE);
 	
+	if ( type_ != DENSE or rightTerm.type_ != DENSE ) {
+		Matrix difference(height_, sumType(type_, rightTerm.type_));
+		
+		for ( int i = 0; i < height_; i ++ ) {
+			int first, last;
+			difference.storedColumns(i, first, last);
+			
+			for ( int j = first; j < last; j ++ )
+				*difference.storedElement(i, j) = (*this).element(i, j) -
+				                                  rightTerm.element(i, j);
+		}
+		
+		return difference;
+	}
+	
 	Matrix difference(height_, width_);
 	
 	for ( int i = 0; i < height_; i ++ )
@@ -856,6 +1603,14 @@ Matrix Matrix::operator * ( const Matrix& rightTerm ) const
 	if ( width_ != rightTerm.height_ )
 		throw LinAlgError(MatErr::INCOMPATIBLE);
 	
+	if ( type_ != DENSE or rightTerm.type_ != DENSE )
+		return (*this).structuredProduct(rightTerm);
+	
+	if (
+	strassenCrossover > 0 and width_ > strassenCrossover and
+	height_ == width_ and rightTerm.width_ == width_ )
+		return (*this).strassenProduct(rightTerm);
+	
 	Matrix product(height_, rightTerm.width_);
 	
 	for ( int i = 0; i < product.height_; i ++ )
@@ -863,9 +1618,9 @@ Matrix Matrix::operator * ( const Matrix& rightTerm ) const
 			double element = 0.0;
 			
 			for ( int k = 0; k < width_; k ++ )
-				element += (*this)[i][k] * rightTerm[k][j];
+				element += array_[i][k] * rightTerm.array_[k][j];
 			
-			product[i][j] = element;
+			product.array_[i][j] = element;
 		}
 	
 	return product;
@@ -876,9 +1631,7 @@ Matrix Matrix::operator * ( double rightScalarTerm ) const
 {
 	Matrix result(*this);
 	
-	for ( int i = 0; i < height_; i ++ )
-		for ( int j = 0; j < width_; j ++ )
-			result[i][j] *= rightScalarTerm;
+	scale(result, rightScalarTerm);
 	
 	return result;
 }
@@ -888,15 +1641,341 @@ Matrix Matrix::operator / ( double rightScalarTerm ) const
 {
 	Matrix result(*this);
 	
-	for ( int i = 0; i < height_; i ++ )
-		for ( int j = 0; j < width_; j ++ )
-			result[i][j] /= rightScalarTerm;
+	result /= rightScalarTerm;
 	
 	return result;
 }
 
 //}
 
+
+//{ Matrix::Cache methods
+
+void Matrix::invalidate ( )
+{
+	if ( cache_ == NULL )
+		return;
+	
+	delete cache_->inverse;
+	delete cache_->lowerUpper;
+	
+	cache_->hasDeterminant = false;
+	cache_->hasTrace = false;
+	cache_->hasNorms = false;
+	cache_->inverse = NULL;
+	cache_->lowerUpper = NULL;
+}
+
+
+// Copies the cache of a model with the same elements, so that copies of a
+// matrix keep its derived quantities.
+void Matrix::copyCache ( const Matrix& model )
+{
+	(*this).enableCache(model.cache_ != NULL);
+	
+	if ( model.cache_ != NULL ) {
+		(*this).invalidate();
+		
+		*cache_ = *model.cache_;
+		
+		if ( model.cache_->inverse != NULL )
+			cache_->inverse = new Matrix(*model.cache_->inverse);
+		if ( model.cache_->lowerUpper != NULL )
+			cache_->lowerUpper = new LuFactors(*model.cache_->lowerUpper);
+	}
+}
+
+
+// LU factors of the matrix, from the cache when it is enabled. Otherwise they
+// are computed into the buffer.
+const LuFactors& Matrix::factors ( LuFactors& buffer ) const
+{
+	if ( cache_ == NULL ) {
+		buffer = (*this).luDecomposition();
+		
+		return buffer;
+	}
+	
+	if ( cache_->lowerUpper == NULL )
+		cache_->lowerUpper = new LuFactors((*this).luDecomposition());
+	
+	return *cache_->lowerUpper;
+}
+
+
+// Solves L y = P b, then U x = y.
+Vector Matrix::substitute ( const LuFactors& lowerUpper,
+                            const Vector&    constants )
+{
+	double** rows = lowerUpper.packed.array_;
+	int order = lowerUpper.packed.height_;
+	
+	Vector solution(order);
+	
+	for ( int i = 0; i < order; i ++ ) {
+		solution[i] = constants[lowerUpper.permutation[i]];
+		
+		for ( int k = 0; k < i; k ++ )
+			solution[i] -= rows[i][k] * solution[k];
+	}
+	
+	for ( int i = order - 1; i >= 0; i -- ) {
+		for ( int k = i + 1; k < order; k ++ )
+			solution[i] -= rows[i][k] * solution[k];
+		
+		solution[i] /= rows[i][i];
+	}
+	
+	return solution;
+}
+
+//}
+
+
+//{ Matrix::Storage methods
+
+// Inversion without leaving the packed storage.
+void Matrix::invertStructured ( )
+{
+	if ( (*this).determinant() == 0.0 )
+		throw LinAlgError(MatErr::SINGULAR);
+	
+	(*this).invalidate();
+	
+	if ( type_ == SCALAR or type_ == DIAGONAL )
+		for ( int k = 0; k < (*this).storedCount(); k ++ )
+			packed_[k] = 1.0 / packed_[k];
+	
+	// The inverse of a lower triangular matrix is lower triangular and comes
+	// column by column from forward substitution. An upper triangular matrix
+	// goes through its transpose.
+	else if ( type_ == TRIANGULAR_UP ) {
+		(*this).transpose();
+		(*this).invertStructured();
+		(*this).transpose();
+	}
+	
+	else if ( type_ == TRIANGULAR_DOWN ) {
+		Matrix inverse(height_, TRIANGULAR_DOWN);
+		
+		for ( int j = 0; j < width_; j ++ ) {
+			*inverse.storedElement(j, j) = 1.0 / *(*this).storedElement(j, j);
+			
+			for ( int i = j + 1; i < height_; i ++ ) {
+				double sum = 0.0;
+				for ( int k = j; k < i; k ++ )
+					sum += *(*this).storedElement(i, k) *
+					       *inverse.storedElement(k, j);
+				
+				*inverse.storedElement(i, j) = -sum /
+				                               *(*this).storedElement(i, i);
+			}
+		}
+		
+		*this = inverse;
+	}
+}
+
+
+void Matrix::release ( )
+{
+	if ( array_ != NULL ) {
+		for ( int i = 0; i < height_; i ++ )
+			delete []array_[i];
+		delete []array_;
+	}
+	
+	delete []packed_;
+	
+	array_ = NULL;
+	packed_ = NULL;
+}
+
+
+// Gives the matrix a new uninitialised dense storage. Any former storage must
+// have been released.
+void Matrix::allocate ( int newHeight, int newWidth )
+{
+	height_ = newHeight;
+	width_ = newWidth;
+	
+	array_ = new double*[height_];
+	for ( int i = 0; i < height_; i ++ )
+		array_[i] = new double[width_];
+	
+	type_ = DENSE;
+	packed_ = NULL;
+}
+
+
+int Matrix::storedCount ( ) const
+{
+	switch ( type_ ) {
+		case IDENTITY :
+			return 0;
+		case SCALAR :
+			return 1;
+		case DIAGONAL :
+			return height_;
+		case TRIANGULAR_UP :
+		case TRIANGULAR_DOWN :
+			return height_ * (height_ + 1) / 2;
+		default :
+			return height_ * width_;
+	}
+}
+
+
+// Range [first, last) of the columns that are stored in a row.
+void Matrix::storedColumns ( int row, int& first, int& last ) const
+{
+	switch ( type_ ) {
+		case IDENTITY :
+			first = last = 0;
+			break;
+		case SCALAR :
+		case DIAGONAL :
+			first = row;
+			last = row + 1;
+			break;
+		case TRIANGULAR_UP :
+			first = row;
+			last = width_;
+			break;
+		case TRIANGULAR_DOWN :
+			first = 0;
+			last = row + 1;
+			break;
+		default :
+			first = 0;
+			last = width_;
+			break;
+	}
+}
+
+
+// Storage of an element, or NULL for a structural zero. The packed triangles
+// are stored row after row. Subscripts aren't checked.
+inline
+double* Matrix::storedElement ( int row, int column ) const
+{
+	switch ( type_ ) {
+		case DENSE :
+			return &array_[row][column];
+		case SCALAR :
+			return row == column ? packed_ : NULL;
+		case DIAGONAL :
+			return row == column ? &packed_[row] : NULL;
+		case TRIANGULAR_UP :
+			if ( column < row )
+				return NULL;
+			return &packed_[row * width_ - row * (row - 1) / 2 + column - row];
+		case TRIANGULAR_DOWN :
+			if ( column > row )
+				return NULL;
+			return &packed_[row * (row + 1) / 2 + column];
+		default :
+			return NULL;
+	}
+}
+
+
+// Products involving at least one structured factor. Diagonal factors scale
+// the rows or the columns of the other factor and keep its structure, and two
+// triangles of the same orientation give a triangle. Other products are done
+// on dense copies.
+Matrix Matrix::structuredProduct ( const Matrix& rightTerm ) const
+{
+	if ( type_ == IDENTITY )
+		return rightTerm;
+	if ( rightTerm.type_ == IDENTITY )
+		return *this;
+	
+	if ( type_ == SCALAR )
+		return rightTerm * packed_[0];
+	if ( rightTerm.type_ == SCALAR )
+		return (*this) * rightTerm.packed_[0];
+	
+	if ( type_ == DIAGONAL or rightTerm.type_ == DIAGONAL ) {
+		Matrix product(type_ == DIAGONAL ? rightTerm : *this);
+		
+		// The copy is written below, so it mustn't keep the operand's cache.
+		product.enableCache(false);
+		
+		for ( int i = 0; i < product.height_; i ++ ) {
+			int first, last;
+			product.storedColumns(i, first, last);
+			
+			for ( int j = first; j < last; j ++ )
+				*product.storedElement(i, j) *= type_ == DIAGONAL
+				                                ? packed_[i]
+				                                : rightTerm.packed_[j];
+		}
+		
+		return product;
+	}
+	
+	if ( type_ == rightTerm.type_ ) {
+		Matrix product(height_, type_);
+		
+		for ( int i = 0; i < height_; i ++ ) {
+			int first, last;
+			product.storedColumns(i, first, last);
+			
+			for ( int j = first; j < last; j ++ ) {
+				double element = 0.0;
+				
+				int kFirst = type_ == TRIANGULAR_UP ? i : j;
+				int kLast = type_ == TRIANGULAR_UP ? j : i;
+				for ( int k = kFirst; k <= kLast; k ++ )
+					element += *(*this).storedElement(i, k) *
+					           *rightTerm.storedElement(k, j);
+				
+				*product.storedElement(i, j) = element;
+			}
+		}
+		
+		return product;
+	}
+	
+	Matrix left(*this), right(rightTerm);
+	left.makeDense();
+	right.makeDense();
+	
+	return left * right;
+}
+
+
+// Type of a sum or a difference.
+MatrixType Matrix::sumType ( MatrixType leftType, MatrixType rightType )
+{
+	bool leftIsDiagonal = leftType == IDENTITY or leftType == SCALAR or
+	                      leftType == DIAGONAL;
+	bool rightIsDiagonal = rightType == IDENTITY or rightType == SCALAR or
+	                       rightType == DIAGONAL;
+	
+	if ( leftType == rightType and leftType != IDENTITY )
+		return leftType;
+	
+	if ( leftIsDiagonal and rightIsDiagonal )
+		return (leftType == DIAGONAL or rightType == DIAGONAL) ? DIAGONAL
+		                                                      : SCALAR;
+	
+	if (
+	leftIsDiagonal and
+	(rightType == TRIANGULAR_UP or rightType == TRIANGULAR_DOWN) )
+		return rightType;
+	
+	if (
+	rightIsDiagonal and
+	(leftType == TRIANGULAR_UP or leftType == TRIANGULAR_DOWN) )
+		return leftType;
+	
+	return DENSE;
+}
+
+//}
+
 //}
 
 
@@ -973,10 +2052,17 @@ void Vector::read ( istream& source )
 	
 	(*this).resize(readDimension);
 	
+	string valueExpression;
+	
+	// Shares the cache of Matrix::read().
+	ExpressionCache* readCache = Matrix::readCache;
+	
 	for ( int i = 0; i < dimension_; i ++ ){
-		string valueExpression;
-		source >> valueExpression;
-		(*this)[i] = eval(valueExpression);
+		if ( not (source >> valueExpression) )
+			throw ParseError(ParseErr::EMPTY);
+		
+		(*this)[i] = readCache != NULL ? (*readCache).eval(valueExpression) :
+		                                 eval(valueExpression);
 	}
 }
 
@@ -1303,6 +2389,183 @@ Vector crossProduct ( const Vector& leftTerm, const Vector& rightTerm )
 	return result;
 }
 
+
+void axpy ( double alpha, const Vector& x, Vector& y )
+{
+	if ( x.dimension_ != y.dimension_ )
+		throw LinAlgError(VecErr::INCOMPATIBLE);
+	
+	for ( int i = 0; i < y.dimension_; i ++ )
+		y.array_[i] += alpha * x.array_[i];
+}
+
+
+void scale ( Matrix& matrix, double factor )
+{
+	matrix.invalidate();
+	
+	if ( matrix.type_ == IDENTITY ) {
+		matrix.type_ = SCALAR;
+		matrix.packed_ = new double[1];
+		matrix.packed_[0] = factor;
+		
+		return;
+	}
+	
+	if ( matrix.type_ != DENSE ) {
+		for ( int k = 0; k < matrix.storedCount(); k ++ )
+			matrix.packed_[k] *= factor;
+		
+		return;
+	}
+	
+	for ( int i = 0; i < matrix.height_; i ++ ) {
+		double* row = matrix.array_[i];
+		
+		for ( int j = 0; j < matrix.width_; j ++ )
+			row[j] *= factor;
+	}
+}
+
+
+void scale ( Vector& vector, double factor )
+{
+	for ( int i = 0; i < vector.dimension_; i ++ )
+		vector.array_[i] *= factor;
+}
+
+
+void add ( const Matrix& leftTerm, const Matrix& rightTerm, Matrix& sum )
+{
+	if (
+	leftTerm.height_ != rightTerm.height_ or
+	leftTerm.width_ != rightTerm.width_ or
+	sum.height_ != leftTerm.height_ or sum.width_ != leftTerm.width_ )
+		throw LinAlgError(MatErr::INCOMPATIBLE);
+	
+	sum.makeDense();
+	sum.invalidate();
+	
+	if ( leftTerm.type_ != DENSE or rightTerm.type_ != DENSE ) {
+		for ( int i = 0; i < sum.height_; i ++ )
+			for ( int j = 0; j < sum.width_; j ++ )
+				sum.array_[i][j] = leftTerm.element(i, j) +
+				                   rightTerm.element(i, j);
+		
+		return;
+	}
+	
+	for ( int i = 0; i < sum.height_; i ++ ) {
+		const double* left = leftTerm.array_[i];
+		const double* right = rightTerm.array_[i];
+		double* destination = sum.array_[i];
+		
+		for ( int j = 0; j < sum.width_; j ++ )
+			destination[j] = left[j] + right[j];
+	}
+}
+
+
+void add ( const Vector& leftTerm, const Vector& rightTerm, Vector& sum )
+{
+	if (
+	leftTerm.dimension_ != rightTerm.dimension_ or
+	sum.dimension_ != leftTerm.dimension_ )
+		throw LinAlgError(VecErr::INCOMPATIBLE);
+	
+	for ( int i = 0; i < sum.dimension_; i ++ )
+		sum.array_[i] = leftTerm.array_[i] + rightTerm.array_[i];
+}
+
+
+void sub ( const Matrix& leftTerm, const Matrix& rightTerm, Matrix& difference )
+{
+	if (
+	leftTerm.height_ != rightTerm.height_ or
+	leftTerm.width_ != rightTerm.width_ or
+	difference.height_ != leftTerm.height_ or
+	difference.width_ != leftTerm.width_ )
+		throw LinAlgError(MatErr::INCOMPATIBLE);
+	
+	difference.makeDense();
+	difference.invalidate();
+	
+	if ( leftTerm.type_ != DENSE or rightTerm.type_ != DENSE ) {
+		for ( int i = 0; i < difference.height_; i ++ )
+			for ( int j = 0; j < difference.width_; j ++ )
+				difference.array_[i][j] = leftTerm.element(i, j) -
+				                          rightTerm.element(i, j);
+		
+		return;
+	}
+	
+	for ( int i = 0; i < difference.height_; i ++ ) {
+		const double* left = leftTerm.array_[i];
+		const double* right = rightTerm.array_[i];
+		double* destination = difference.array_[i];
+		
+		for ( int j = 0; j < difference.width_; j ++ )
+			destination[j] = left[j] - right[j];
+	}
+}
+
+
+void sub ( const Vector& leftTerm, const Vector& rightTerm, Vector& difference )
+{
+	if (
+	leftTerm.dimension_ != rightTerm.dimension_ or
+	difference.dimension_ != leftTerm.dimension_ )
+		throw LinAlgError(VecErr::INCOMPATIBLE);
+	
+	for ( int i = 0; i < difference.dimension_; i ++ )
+		difference.array_[i] = leftTerm.array_[i] - rightTerm.array_[i];
+}
+
+
+// C = alpha * A * B + beta * C. C is read while being written, so it can't be
+// one of the factors. As in BLAS, a zero beta ignores the former content of C.
+void gemm ( double alpha, const Matrix& a, const Matrix& b, double beta,
+            Matrix& c )
+{
+	if (
+	a.width_ != b.height_ or
+	c.height_ != a.height_ or c.width_ != b.width_ or
+	&c == &a or &c == &b )
+		throw LinAlgError(MatErr::INCOMPATIBLE);
+	
+	if ( a.type_ != DENSE or b.type_ != DENSE ) {
+		Matrix denseA(a), denseB(b);
+		denseA.makeDense();
+		denseB.makeDense();
+		
+		gemm(alpha, denseA, denseB, beta, c);
+		
+		return;
+	}
+	
+	c.makeDense();
+	c.invalidate();
+	
+	for ( int i = 0; i < c.height_; i ++ ) {
+		double* destination = c.array_[i];
+		
+		if ( beta == 0.0 )
+			for ( int j = 0; j < c.width_; j ++ )
+				destination[j] = 0.0;
+		else if ( beta != 1.0 )
+			for ( int j = 0; j < c.width_; j ++ )
+				destination[j] *= beta;
+		
+		for ( int k = 0; k < a.width_; k ++ ) {
+			double factor = alpha * a.array_[i][k];
+			const double* right = b.array_[k];
+			
+			for ( int j = 0; j < c.width_; j ++ )
+				destination[j] += factor * right[j];
+		}
+	}
+}
+
 //}
 
 
@@ -1310,5 +2573,196 @@ Vector crossProduct ( const Vector& leftTerm, const Vector& rightTerm )
 
 //}
 
+
+//{ Strassen-Winograd
+
+inline
+Strassen::Block Strassen::Block::quadrant ( int row, int column,
+                                            int order ) const
+{
+	return {data + row * order * stride + column * order, stride};
+}
+
+
+int Strassen::paddedOrder ( int order, int crossover )
+{
+	int levels = 0;
+	while ( order > crossover ) {
+		order = (order + 1) / 2;
+		levels ++;
+	}
+	
+	return order << levels;
+}
+
+
+void Strassen::add ( Block leftTerm, Block rightTerm, Block sum, int order )
+{
+	for ( int i = 0; i < order; i ++ ) {
+		const double* left = leftTerm.row(i);
+		const double* right = rightTerm.row(i);
+		double* destination = sum.row(i);
+		
+		for ( int j = 0; j < order; j ++ )
+			destination[j] = left[j] + right[j];
+	}
+}
+
+
+void Strassen::subtract ( Block leftTerm, Block rightTerm, Block difference,
+                          int order )
+{
+	for ( int i = 0; i < order; i ++ ) {
+		const double* left = leftTerm.row(i);
+		const double* right = rightTerm.row(i);
+		double* destination = difference.row(i);
+		
+		for ( int j = 0; j < order; j ++ )
+			destination[j] = left[j] - right[j];
+	}
+}
+
+
+void Strassen::classicalProduct ( Block leftTerm, Block rightTerm,
+                                  Block product, int order )
+{
+	for ( int i = 0; i < order; i ++ ) {
+		double* destination = product.row(i);
+		
+		for ( int j = 0; j < order; j ++ )
+			destination[j] = 0.0;
+		
+		for ( int k = 0; k < order; k ++ ) {
+			double factor = leftTerm.row(i)[k];
+			const double* right = rightTerm.row(k);
+			
+			for ( int j = 0; j < order; j ++ )
+				destination[j] += factor * right[j];
+		}
+	}
+}
+
+
+// Winograd's variant (7 products, 15 additions). The products are scheduled so
+// that only three temporary quadrants are needed besides the result quadrants,
+// which bounds the whole recursion to 'order * order' doubles of workspace.
+void Strassen::product ( Block a, Block b, Block c, int order, int crossover,
+                         double* workspace )
+{
+	if ( order <= crossover or order % 2 != 0 ) {
+		classicalProduct(a, b, c, order);
+		return;
+	}
+	
+	int half = order / 2;
+	
+	Block a11 = a.quadrant(0, 0, half), a12 = a.quadrant(0, 1, half);
+	Block a21 = a.quadrant(1, 0, half), a22 = a.quadrant(1, 1, half);
+	Block b11 = b.quadrant(0, 0, half), b12 = b.quadrant(0, 1, half);
+	Block b21 = b.quadrant(1, 0, half), b22 = b.quadrant(1, 1, half);
+	Block c11 = c.quadrant(0, 0, half), c12 = c.quadrant(0, 1, half);
+	Block c21 = c.quadrant(1, 0, half), c22 = c.quadrant(1, 1, half);
+	
+	Block x = {workspace, half};
+	Block y = {workspace + half * half, half};
+	Block z = {workspace + 2 * half * half, half};
+	double* next = workspace + 3 * half * half;
+	
+	subtract(a11, a21, x, half);                 // S3
+	subtract(b22, b12, y, half);                 // T3
+	product(x, y, c21, half, crossover, next);   // P7
+	
+	add(a21, a22, x, half);                      // S1
+	subtract(b12, b11, y, half);                 // T1
+	product(x, y, c22, half, crossover, next);   // P5
+	
+	subtract(x, a11, x, half);                   // S2
+	subtract(b22, y, y, half);                   // T2
+	product(x, y, c12, half, crossover, next);   // P6
+	
+	product(a11, b11, z, half, crossover, next); // P1
+	
+	add(c12, z, c12, half);                      // U2 = P1 + P6
+	add(c12, c21, c21, half);                    // U3 = U2 + P7
+	add(c12, c22, c12, half);                    // U4 = U2 + P5
+	add(c21, c22, c22, half);                    // U7 = U3 + P5
+	
+	subtract(a12, x, x, half);                   // S4
+	product(x, b22, c11, half, crossover, next); // P3
+	add(c12, c11, c12, half);                    // U5 = U4 + P3
+	
+	subtract(y, b21, y, half);                   // T4
+	product(a22, y, c11, half, crossover, next); // P4
+	subtract(c21, c11, c21, half);               // U6 = U3 - P4
+	
+	product(a12, b21, c11, half, crossover, next); // P2
+	add(c11, z, c11, half);                        // U1 = P1 + P2
+}
+
+
+// Top level of the recursion with the seven products computed concurrently.
+// Each product gets its own operands, destination and workspace, which costs
+// about 5.5 times the padded matrix in extra memory.
+void Strassen::parallelProduct ( Block a, Block b, Block c, int order,
+                                 int crossover, int threadCount )
+{
+	int half = order / 2;
+	size_t quadrantSize = size_t(half) * half;
+	
+	vector<double> buffer(22 * quadrantSize);
+	Block s[4], t[4], p[7];
+	for ( int i = 0; i < 4; i ++ ) {
+		s[i] = {&buffer[i * quadrantSize], half};
+		t[i] = {&buffer[(4 + i) * quadrantSize], half};
+	}
+	for ( int i = 0; i < 7; i ++ )
+		p[i] = {&buffer[(8 + i) * quadrantSize], half};
+	double* workspaces = &buffer[15 * quadrantSize];
+	
+	Block a11 = a.quadrant(0, 0, half), a12 = a.quadrant(0, 1, half);
+	Block a21 = a.quadrant(1, 0, half), a22 = a.quadrant(1, 1, half);
+	Block b11 = b.quadrant(0, 0, half), b12 = b.quadrant(0, 1, half);
+	Block b21 = b.quadrant(1, 0, half), b22 = b.quadrant(1, 1, half);
+	
+	add(a21, a22, s[0], half);
+	subtract(s[0], a11, s[1], half);
+	subtract(a11, a21, s[2], half);
+	subtract(a12, s[1], s[3], half);
+	subtract(b12, b11, t[0], half);
+	subtract(b22, t[0], t[1], half);
+	subtract(b22, b12, t[2], half);
+	subtract(t[1], b21, t[3], half);
+	
+	Block leftTerms[7] = {a11, a12, s[3], a22, s[0], s[1], s[2]};
+	Block rightTerms[7] = {b11, b21, b22, t[3], t[0], t[1], t[2]};
+	
+	atomic<int> nextProduct(0);
+	auto worker = [&] ( ) {
+		for ( int i = nextProduct ++; i < 7; i = nextProduct ++ )
+			product(leftTerms[i], rightTerms[i], p[i], half, crossover,
+			        workspaces + i * quadrantSize);
+	};
+	
+	vector<thread> workers;
+	for ( int i = 1; i < threadCount and i < 7; i ++ )
+		workers.push_back(thread(worker));
+	worker();
+	for ( thread& runningWorker : workers )
+		runningWorker.join();
+	
+	Block c11 = c.quadrant(0, 0, half), c12 = c.quadrant(0, 1, half);
+	Block c21 = c.quadrant(1, 0, half), c22 = c.quadrant(1, 1, half);
+	
+	add(p[0], p[1], c11, half);   // U1 = P1 + P2
+	add(p[0], p[5], p[5], half);  // U2 = P1 + P6
+	add(p[5], p[6], p[6], half);  // U3 = U2 + P7
+	add(p[6], p[4], c22, half);   // U7 = U3 + P5
+	subtract(p[6], p[3], c21, half); // U6 = U3 - P4
+	add(p[5], p[4], p[4], half);  // U4 = U2 + P5
+	add(p[4], p[2], c12, half);   // U5 = U4 + P3
+}
+
+//}
+
 //}
 
@@ -0,0 +1,463 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : LinearAlgebra_Batch.hpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 19 2026
+// DESCRIPTION : Determinant, inverse and linear solve over large batches of
+//               small (2x2, 3x3, 4x4) matrices.
+//     REMARKS : Batches are stored as structures of arrays : every element
+//               position has its own contiguous array with one lane per
+//               matrix, so the kernels below are plain loops over the lanes.
+//               GCC vectorises them at -O3 (see -fopt-info-vec); its cost
+//               model at -O2 leaves them scalar. Singular matrices are
+//               reported through a flag per lane instead of an exception.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+using namespace std;
+
+
+//{ Includes
+
+#include <vector>
+#include <cstdint>
+
+#include "LinearAlgebra.hpp"
+#include "LinearAlgebra_Errors.hpp"  // Exception handler.
+
+//}
+
+
+//{ Declarations
+
+//{ Classes
+
+template <int Height, int Width>
+class MatrixBatch
+{
+public:
+	// Constructor
+	MatrixBatch ( int = 0 );
+	
+	// Modifying methods
+	void resize ( int );
+	void set ( int, const Matrix& );
+	
+	// Non-modifying methods
+	int getCount ( ) const;
+	Matrix get ( int ) const;
+	
+	// Lane array of the element at (row, column) of every matrix.
+	      double* lanes ( int, int );
+	const double* lanes ( int, int ) const;
+	
+protected:
+	// Attributes
+	           int count_;
+	vector<double> elements_;
+};
+
+
+template <int Order>
+using SquareMatrixBatch = MatrixBatch<Order, Order>;
+
+template <int Dimension>
+using VectorBatch = MatrixBatch<Dimension, 1>;
+
+//}
+
+
+//{ Functions
+
+template <int Order>
+void batchDeterminant ( const SquareMatrixBatch<Order>&, double* );
+
+template <int Order>
+void batchInverse ( const SquareMatrixBatch<Order>&, SquareMatrixBatch<Order>&,
+                    uint8_t* );
+
+template <int Order>
+void batchSolve ( const SquareMatrixBatch<Order>&, const VectorBatch<Order>&,
+                  VectorBatch<Order>&, uint8_t* );
+
+//}
+
+//}
+
+
+
+
+//{ MatrixBatch
+
+//{ MatrixBatch::Constructor
+
+template <int Height, int Width>
+MatrixBatch<Height, Width>::MatrixBatch ( int initCount )
+{
+	count_ = 0;
+	
+	(*this).resize(initCount);
+}
+
+//}
+
+
+//{ MatrixBatch::Modifying methods
+
+template <int Height, int Width>
+void MatrixBatch<Height, Width>::resize ( int newCount )
+{
+	if ( newCount < 0 )
+		throw LinAlgError(MatErr::BATCH_INDEX);
+	
+	vector<double> buffer(Height * Width * size_t(newCount), 0.0);
+	
+	for ( int k = 0; k < Height * Width; k ++ )
+		for ( int i = 0; i < count_ and i < newCount; i ++ )
+			buffer[k * size_t(newCount) + i] =
+			elements_[k * size_t(count_) + i];
+	
+	elements_.swap(buffer);
+	count_ = newCount;
+}
+
+
+template <int Height, int Width>
+void MatrixBatch<Height, Width>::set ( int index, const Matrix& model )
+{
+	if ( index >= count_ or index < 0 )
+		throw LinAlgError(MatErr::BATCH_INDEX);
+	if ( model.getHeight() != Height or model.getWidth() != Width )
+		throw LinAlgError(MatErr::INCOMPATIBLE);
+	
+	for ( int i = 0; i < Height; i ++ )
+		for ( int j = 0; j < Width; j ++ )
+			(*this).lanes(i, j)[index] = model[i][j];
+}
+
+//}
+
+
+//{ MatrixBatch::Non-modifying methods
+
+template <int Height, int Width>
+inline
+int MatrixBatch<Height, Width>::getCount ( ) const
+{
+	return count_;
+}
+
+
+template <int Height, int Width>
+Matrix MatrixBatch<Height, Width>::get ( int index ) const
+{
+	if ( index >= count_ or index < 0 )
+		throw LinAlgError(MatErr::BATCH_INDEX);
+	
+	Matrix result(Height, Width);
+	
+	for ( int i = 0; i < Height; i ++ )
+		for ( int j = 0; j < Width; j ++ )
+			result[i][j] = (*this).lanes(i, j)[index];
+	
+	return result;
+}
+
+
+template <int Height, int Width>
+inline
+double* MatrixBatch<Height, Width>::lanes ( int row, int column )
+{
+	return elements_.data() + size_t(row * Width + column) * count_;
+}
+
+
+template <int Height, int Width>
+inline
+const double* MatrixBatch<Height, Width>::lanes ( int row, int column ) const
+{
+	return elements_.data() + size_t(row * Width + column) * count_;
+}
+
+//}
+
+//}
+
+
+//{ Small matrix kernels
+
+// Closed forms for one lane. 'adjugate' writes the transposed cofactors and
+// returns the determinant, so an inverse is the adjugate over the determinant.
+namespace SmallMatrix
+{
+
+template <int Order>
+struct Kernel;
+
+
+template <>
+struct Kernel<2>
+{
+	static double determinant ( const double (&m)[2][2] )
+	{
+		return m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	}
+	
+	static double adjugate ( const double (&m)[2][2], double (&adj)[2][2] )
+	{
+		adj[0][0] =  m[1][1];
+		adj[0][1] = -m[0][1];
+		adj[1][0] = -m[1][0];
+		adj[1][1] =  m[0][0];
+		
+		return determinant(m);
+	}
+};
+
+
+template <>
+struct Kernel<3>
+{
+	static double determinant ( const double (&m)[3][3] )
+	{
+		return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+		       m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+		       m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+	}
+	
+	static double adjugate ( const double (&m)[3][3], double (&adj)[3][3] )
+	{
+		adj[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		adj[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+		adj[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+		
+		adj[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+		adj[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+		adj[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+		
+		adj[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+		adj[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+		adj[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+		
+		return m[0][0] * adj[0][0] + m[0][1] * adj[1][0] + m[0][2] * adj[2][0];
+	}
+};
+
+
+// The 4x4 forms expand along the 2x2 minors of the two top rows (s) and of the
+// two bottom rows (c), which are shared between the determinant and all the
+// cofactors.
+template <>
+struct Kernel<4>
+{
+	static double determinant ( const double (&m)[4][4] )
+	{
+		double adj[4][4];
+		
+		return adjugate(m, adj);
+	}
+	
+	static double adjugate ( const double (&m)[4][4], double (&adj)[4][4] )
+	{
+		double s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+		double s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+		double s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+		double s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+		double s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+		double s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+		
+		double c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+		double c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+		double c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+		double c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+		double c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+		double c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+		
+		adj[0][0] =  m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3;
+		adj[0][1] = -m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3;
+		adj[0][2] =  m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3;
+		adj[0][3] = -m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3;
+		
+		adj[1][0] = -m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1;
+		adj[1][1] =  m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1;
+		adj[1][2] = -m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1;
+		adj[1][3] =  m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1;
+		
+		adj[2][0] =  m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0;
+		adj[2][1] = -m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0;
+		adj[2][2] =  m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0;
+		adj[2][3] = -m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0;
+		
+		adj[3][0] = -m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0;
+		adj[3][1] =  m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0;
+		adj[3][2] = -m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0;
+		adj[3][3] =  m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0;
+		
+		return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	}
+};
+
+}
+
+//}
+
+
+
+
+//{ Lane blocks
+
+// The inverse and the solve go through blocks of lanes : their adjugates are
+// written to local arrays, which can't alias the batches, then scaled into
+// the results. Every loop over the lanes of a block is free of branches, so
+// that the compiler vectorises it without checking for aliasing at run time.
+namespace SmallMatrix
+{
+
+const int BLOCK_LANES = 32;
+
+
+// The adjugates of the lanes [first, first + count) and the inverses of their
+// determinants, which are zero for the singular lanes. The choice is made
+// with arithmetic, dividing 0 by 1 for the singular lanes : a branch, or a
+// select on a comparison, keeps the compiler from vectorising the loop.
+template <int Order>
+void adjugateBlock ( const SquareMatrixBatch<Order>& matrices, int first,
+                     int count,
+                     double (&__restrict adj)[Order][Order][BLOCK_LANES],
+                     double (&__restrict scale)[BLOCK_LANES] )
+{
+	const double* source[Order][Order];
+	for ( int i = 0; i < Order; i ++ )
+		for ( int j = 0; j < Order; j ++ )
+			source[i][j] = matrices.lanes(i, j) + first;
+	
+	for ( int lane = 0; lane < count; lane ++ ) {
+		double m[Order][Order], laneAdjugate[Order][Order];
+		for ( int i = 0; i < Order; i ++ )
+			for ( int j = 0; j < Order; j ++ )
+				m[i][j] = source[i][j][lane];
+		
+		double determinant = Kernel<Order>::adjugate(m, laneAdjugate);
+		
+		for ( int i = 0; i < Order; i ++ )
+			for ( int j = 0; j < Order; j ++ )
+				adj[i][j][lane] = laneAdjugate[i][j];
+		
+		double isRegular = determinant != 0.0;
+		scale[lane] = isRegular / (determinant + (1.0 - isRegular));
+	}
+}
+
+}
+
+//}
+
+
+
+
+//{ Functions
+
+template <int Order>
+void batchDeterminant ( const SquareMatrixBatch<Order>& matrices,
+                        double* determinants )
+{
+	const double* source[Order][Order];
+	for ( int i = 0; i < Order; i ++ )
+		for ( int j = 0; j < Order; j ++ )
+			source[i][j] = matrices.lanes(i, j);
+	
+	int count = matrices.getCount();
+	for ( int lane = 0; lane < count; lane ++ ) {
+		double m[Order][Order];
+		for ( int i = 0; i < Order; i ++ )
+			for ( int j = 0; j < Order; j ++ )
+				m[i][j] = source[i][j][lane];
+		
+		determinants[lane] = SmallMatrix::Kernel<Order>::determinant(m);
+	}
+}
+
+
+// A singular lane gets its flag set and a zero inverse, as does a lane whose
+// determinant overflows. The flags are written for every lane, so the array
+// doesn't need to be cleared beforehand. The inverses may be the matrices.
+template <int Order>
+void batchInverse ( const SquareMatrixBatch<Order>& matrices,
+                    SquareMatrixBatch<Order>& inverses, uint8_t* singular )
+{
+	using namespace SmallMatrix;
+	
+	int count = matrices.getCount();
+	if ( inverses.getCount() != count )
+		inverses.resize(count);
+	
+	double adj[Order][Order][BLOCK_LANES], scale[BLOCK_LANES];
+	
+	for ( int first = 0; first < count; first += BLOCK_LANES ) {
+		int blockCount = min(BLOCK_LANES, count - first);
+		
+		adjugateBlock(matrices, first, blockCount, adj, scale);
+		
+		for ( int i = 0; i < Order; i ++ )
+			for ( int j = 0; j < Order; j ++ ) {
+				double* __restrict destination = inverses.lanes(i, j) + first;
+				
+				for ( int lane = 0; lane < blockCount; lane ++ )
+					destination[lane] = adj[i][j][lane] * scale[lane];
+			}
+		
+		for ( int lane = 0; lane < blockCount; lane ++ )
+			singular[first + lane] = scale[lane] == 0.0;
+	}
+}
+
+
+// Same flags as batchInverse(). The solutions may be the constants.
+template <int Order>
+void batchSolve ( const SquareMatrixBatch<Order>& matrices,
+                  const VectorBatch<Order>& constants,
+                  VectorBatch<Order>& solutions, uint8_t* singular )
+{
+	using namespace SmallMatrix;
+	
+	int count = matrices.getCount();
+	if ( constants.getCount() != count )
+		throw LinAlgError(MatErr::INCOMPATIBLE);
+	if ( solutions.getCount() != count )
+		solutions.resize(count);
+	
+	double adj[Order][Order][BLOCK_LANES], scale[BLOCK_LANES];
+	double right[Order][BLOCK_LANES];
+	
+	for ( int first = 0; first < count; first += BLOCK_LANES ) {
+		int blockCount = min(BLOCK_LANES, count - first);
+		
+		adjugateBlock(matrices, first, blockCount, adj, scale);
+		
+		// Copied, since the solutions may be written over the constants.
+		for ( int j = 0; j < Order; j ++ ) {
+			const double* source = constants.lanes(j, 0) + first;
+			
+			for ( int lane = 0; lane < blockCount; lane ++ )
+				right[j][lane] = source[lane];
+		}
+		
+		for ( int i = 0; i < Order; i ++ ) {
+			double* __restrict destination = solutions.lanes(i, 0) + first;
+			
+			for ( int lane = 0; lane < blockCount; lane ++ ) {
+				double element = 0.0;
+				for ( int j = 0; j < Order; j ++ )
+					element += adj[i][j][lane] * right[j][lane];
+				
+				destination[lane] = element * scale[lane];
+			}
+		}
+		
+		for ( int lane = 0; lane < blockCount; lane ++ )
+			singular[first + lane] = scale[lane] == 0.0;
+	}
+}
+
+//}
@@ -26,7 +26,8 @@ namespace MatErr
 	           SINGULAR,
 	           NOT_SYMMETRIC,
 	           INCOMPATIBLE,
-	           VECTORS_DIMENSIONS};
+	           VECTORS_DIMENSIONS,
+	           BATCH_INDEX};
 
 	const string messages[] = {"Invalid height.",
 	                           "Invalid width.",
@@ -36,7 +37,8 @@ namespace MatErr
 	                           "Singular matrix (not invertible).",
 	                           "Not symmetric matrix.",
 	                           "Incompatible operands.",
-	                           "Column vectors not the same dimension."};
+	                           "Column vectors not the same dimension.",
+	                           "Batch index out of range."};
 }
 
 namespace VecErr
@@ -9,87 +9,1217 @@
 #pragma once
 
 #include <cmath>
+#include <algorithm>
+#include <cctype>
 #include <string>
-#include <sstream>
+#include <string_view>
+#include <charconv>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "MathParser_Errors.hpp"  // Exception handler.
 
 using namespace std;
 
 
+// The parser also runs at compile time (see evalConstant). consteval needs
+// C++20; older compilers get a constexpr function, which is still evaluated
+// at compile time when its result initializes a constexpr variable.
+#if defined(__cpp_consteval)
+	#define GALLICA_CONSTEVAL consteval
+#else
+	#define GALLICA_CONSTEVAL constexpr
+#endif
+
+#if defined(__cpp_lib_is_constant_evaluated)
+	#define GALLICA_IS_CONSTANT_EVALUATED() is_constant_evaluated()
+#else
+	#define GALLICA_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+
+
 
 namespace Const
 {
-const double PI = 3.1415926535897932;
-const double SPEED_LIGHT = 2.99792458e8;
-const double GRAV_CONST = 6.67384e-11;
-const double E = 1.602176565e-19;
-const double AVOG = 6.02214129e23;
+constexpr double PI = 3.1415926535897932;
+constexpr double SPEED_LIGHT = 2.99792458e8;
+constexpr double GRAV_CONST = 6.67384e-11;
+constexpr double E = 1.602176565e-19;
+constexpr double AVOG = 6.02214129e23;
+}
+
+
+namespace Parsing
+{
+	const int MAX_STACK_DEPTH = 64;
+	const int MAX_NESTING = 256;
+	const int POWER_PRECEDENCE = 3;
+	const int BATCH_BLOCK = 256;  // Lanes evaluated together by a batch.
+	
+	enum TokenType {NUMBER, IDENTIFIER, OPERATOR, LEFT_PARENTHESIS,
+	                RIGHT_PARENTHESIS, END};
+	
+	enum OpCode {PUSH, LOAD, ADD, SUBTRACT, MULTIPLY, DIVIDE, POWER, NEGATE,
+	             CALL};
+	
+	// A token refers to its text by offset in the source.
+	struct Token
+	{
+		TokenType type;
+		double    value;     // Value of a NUMBER.
+		char      symbol;    // Character of an OPERATOR.
+		int       position;
+		int       length;
+	};
+	
+	// Splits an expression into tokens on demand.
+	class Lexer
+	{
+	public:
+		constexpr Lexer ( string_view );
+		
+		constexpr ParseErr::Code next ( Token& );
+		
+		constexpr string_view text ( const Token& ) const;
+		
+	protected:
+		string_view source_;
+		int         position_;
+	};
+	
+	// Parses an expression and hands its operations in postfix order to a
+	// builder, which either records them (Expression) or carries them out
+	// right away (Calculator). Builders provide :
+	//   bool push ( double );
+	//   bool load ( int );                       (variable by index)
+	//   bool apply ( OpCode );                   (binary operators, NEGATE)
+	//   bool call ( double (*) ( double ) );
+	//    int find ( string_view ) const;         (variable index, -1 if none)
+	// and return false when their stack would overflow.
+	template <class Builder>
+	class Parser
+	{
+	public:
+		constexpr Parser ( string_view, Builder& );
+		
+		constexpr ParseErr::Code parse ( );
+		constexpr            int getPosition ( ) const;
+		
+	protected:
+		constexpr bool parseBinary ( int );
+		constexpr bool parseUnary ( );
+		constexpr bool parsePrimary ( );
+		constexpr bool advance ( );
+		constexpr bool fail ( ParseErr::Code, int );
+		
+		static constexpr int precedence ( const Token& );
+		
+		Lexer          lexer_;
+		Token          token_;
+		Builder&       builder_;
+		ParseErr::Code error_;
+		int            position_;  // Offset of the error.
+		int            nesting_;
+	};
+	
+	// Evaluates as it parses, on a fixed stack.
+	class Calculator
+	{
+	public:
+		constexpr Calculator ( );
+		
+		constexpr bool push ( double );
+		constexpr bool load ( int );
+		constexpr bool apply ( OpCode );
+		constexpr bool call ( double (*) ( double ) );
+		constexpr  int find ( string_view ) const;
+		
+		constexpr double getResult ( ) const;
+		
+	protected:
+		double stack_[MAX_STACK_DEPTH];
+		int    top_;
+	};
+	
+	struct NamedConstant
+	{
+		const char* name;
+		double      value;
+	};
+	
+	struct NamedFunction
+	{
+		const char* name;
+		double      (*function) ( double );
+	};
+	
+	constexpr NamedConstant constants[] = {{"PI", Const::PI},
+	                                   {"SPEED_LIGHT", Const::SPEED_LIGHT},
+	                                   {"GRAV_CONST", Const::GRAV_CONST},
+	                                   {"E", Const::E},
+	                                   {"AVOG", Const::AVOG}};
+	
+	constexpr NamedFunction functions[] = {
+		{"sin",   [] ( double x ) { return sin(x); }},
+		{"cos",   [] ( double x ) { return cos(x); }},
+		{"tan",   [] ( double x ) { return tan(x); }},
+		{"asin",  [] ( double x ) { return asin(x); }},
+		{"acos",  [] ( double x ) { return acos(x); }},
+		{"atan",  [] ( double x ) { return atan(x); }},
+		{"sqrt",  [] ( double x ) { return sqrt(x); }},
+		{"exp",   [] ( double x ) { return exp(x); }},
+		{"log",   [] ( double x ) { return log(x); }},
+		{"log10", [] ( double x ) { return log10(x); }},
+		{"abs",   [] ( double x ) { return fabs(x); }},
+		{"floor", [] ( double x ) { return floor(x); }},
+		{"ceil",  [] ( double x ) { return ceil(x); }}};
+	
+	constexpr bool isBlank ( char );
+	constexpr bool isDigit ( char );
+	constexpr bool isLetter ( char );
+	
+	constexpr ParseErr::Code scanNumber ( string_view, double&, int& );
+	
+	constexpr double power ( double, double );
+	constexpr double binaryOperation ( OpCode, double, double );
 }
 
 
-double eval ( string );
+// An expression compiled once into a stack program, to be evaluated any
+// number of times without parsing it again.
+//
+// Grammar, from the lowest precedence :
+//   sum     : product (('+' | '-') product)*
+//   product : unary (('*' | '/') unary)*
+//   unary   : ('-' | '+') unary | power
+//   power   : primary ('^' unary)?          (right associative)
+//   primary : number | variable | constant | function '(' sum ')' | '(' sum ')'
+// Constants may be written with or without their "Const::" prefix. Variables
+// are named at compilation and take precedence over constants; their values
+// are passed to evaluate() in the same order.
+class Expression
+{
+public:
+	// Constructors
+	Expression ( );
+	Expression ( string_view, const vector<string>& = vector<string>() );
+	
+	// Modifying methods
+	void compile ( string_view, const vector<string>& = vector<string>() );
+	
+	// Non-modifying methods
+	double evaluate ( const double* = NULL ) const;
+	  void evaluate ( int, const double* const*, double* ) const;
+	   int getSize ( ) const;
+	   int getVariableCount ( ) const;
+	
+protected:
+	template <class Builder> friend class Parsing::Parser;
+	friend class NativeExpression;  // See "MathParser_Jit.hpp".
+	
+	struct Instruction
+	{
+		Parsing::OpCode code;
+		double          value;                   // Operand of PUSH.
+		int             variable;                // Operand of LOAD.
+		double          (*function) ( double );  // Operand of CALL.
+		bool            isImmediate;             // Right operand in value.
+	};
+	
+	// Builder methods (see Parsing::Parser)
+	bool push ( double );
+	bool load ( int );
+	bool apply ( Parsing::OpCode );
+	bool call ( double (*) ( double ) );
+	 int find ( string_view ) const;
+	
+	void evaluateBlock ( int, int, const double* const*, double*,
+	                     double* ) const;
+	
+	// Attributes
+	vector<Instruction> program_;
+	vector<string>      variables_;
+	int                 depth_;     // Current stack depth while compiling.
+	int                 maxDepth_;
+};
+
+
+// Remembers the values of the expression texts it evaluates, for inputs made
+// of a small vocabulary of repeated entries ("1/3", "-1/2", "0", ...). New
+// texts stop being remembered once the capacity is reached.
+class ExpressionCache
+{
+public:
+	// Constructor
+	ExpressionCache ( size_t = 4096 );
+	
+	// Modifying methods
+	double eval ( string_view );
+	  void clear ( );
+	
+	// Non-modifying methods
+	size_t getHits ( ) const;
+	size_t getMisses ( ) const;
+	double getHitRate ( ) const;
+	size_t getSize ( ) const;
+
+protected:
+	// Attributes
+	unordered_map<string, double> values_;
+	string                        key_;       // Reused for lookups.
+	size_t                        capacity_;
+	size_t                        hits_;
+	size_t                        misses_;
+};
+
+
+// Allocation free evaluation, reporting malformed expressions instead of
+// throwing. The result is only written on success (ParseErr::NONE).
+ParseErr::Code eval ( string_view, double& );
+
+ParseErr::Code parseNumber ( string_view, double& );
 
-void parseExpression ( string, string, double&, double& );
+// Evaluates an expression at compile time, for instance
+//   constexpr double ACCELERATION = evalConstant("4.0 * 400 / 40");
+// A malformed expression fails the build, and so does an expression the
+// compiler cannot evaluate : math functions and '^' with a non integer
+// exponent.
+GALLICA_CONSTEVAL double evalConstant ( string_view );
 
-double evalAddition ( string );
+double eval ( string_view );
 
-double evalSubstraction ( string );
+void parseExpression ( string_view, string_view, double&, double& );
 
-double evalMultiplication ( string );
+double evalAddition ( string_view );
 
-double evalDivision ( string );
+double evalSubstraction ( string_view );
+
+double evalMultiplication ( string_view );
+
+double evalDivision ( string_view );
 
 
 //##############################################################################
 
 
-double eval( string expressionToEval )
+//{ Parsing::Lexer
+
+constexpr Parsing::Lexer::Lexer ( string_view source )
+	: source_(source), position_(0)
+{
+}
+
+
+constexpr ParseErr::Code Parsing::Lexer::next ( Token& token )
 {
-  double result;
-	if ( int(expressionToEval.find("+")) != -1 )
-		result = evalAddition(expressionToEval);
+	int length = int(source_.size());
+	
+	while ( position_ < length and isBlank(source_[position_]) )
+		position_++;
+	
+	token.position = position_;
+	token.length = 1;
+	token.value = 0.0;
+	token.symbol = 0;
+	
+	if ( position_ >= length ) {
+		token.type = END;
+		token.length = 0;
+		return ParseErr::NONE;
+	}
+	
+	char current = source_[position_];
+	
+	if ( isDigit(current) or current == '.' ) {
+		ParseErr::Code code = scanNumber(source_.substr(position_),
+		                                 token.value, token.length);
+		if ( code != ParseErr::NONE )
+			return code;
+		
+		token.type = NUMBER;
+	}
+	else if ( isLetter(current) ) {
+		int end = position_;
+		while (
+			end < length and
+			( isLetter(source_[end]) or isDigit(source_[end]) or
+			  source_[end] == ':' ) )
+			end++;
 		
+		token.type = IDENTIFIER;
+		token.length = end - position_;
+	}
 	else if (
-	( int(expressionToEval.find("-")) != -1 ) and
-	( int(expressionToEval.find("-")) != 0 ) )
-		result = evalSubstraction(expressionToEval);
+		current == '+' or current == '-' or current == '*' or
+		current == '/' or current == '^' ) {
+		token.type = OPERATOR;
+		token.symbol = current;
+	}
+	else if ( current == '(' )
+		token.type = LEFT_PARENTHESIS;
+	else if ( current == ')' )
+		token.type = RIGHT_PARENTHESIS;
+	else
+		return ParseErr::CHARACTER;
+	
+	position_ += token.length;
+	
+	return ParseErr::NONE;
+}
+
+
+constexpr string_view Parsing::Lexer::text ( const Token& token ) const
+{
+	return source_.substr(token.position, token.length);
+}
+
+//}
+
+
+//{ Parsing::Parser
+
+template <class Builder>
+constexpr Parsing::Parser<Builder>::Parser ( string_view source,
+                                             Builder&    builder )
+	: lexer_(source), token_(), builder_(builder), error_(ParseErr::NONE),
+	  position_(-1), nesting_(0)
+{
+}
+
+
+template <class Builder>
+constexpr ParseErr::Code Parsing::Parser<Builder>::parse ( )
+{
+	if ( not (*this).advance() )
+		return error_;
+	
+	if ( token_.type == END )
+		(*this).fail(ParseErr::EMPTY, 0);
+	else if ( not (*this).parseBinary(1) )
+		return error_;
+	else if ( token_.type == RIGHT_PARENTHESIS )
+		(*this).fail(ParseErr::PARENTHESIS, token_.position);
+	else if ( token_.type != END )
+		(*this).fail(ParseErr::TRAILING, token_.position);
+	
+	return error_;
+}
+
+
+template <class Builder>
+constexpr int Parsing::Parser<Builder>::getPosition ( ) const
+{
+	return position_;
+}
+
+
+// Binary operators of at least the given precedence.
+template <class Builder>
+constexpr bool Parsing::Parser<Builder>::parseBinary ( int minimum )
+{
+	if ( ++nesting_ > MAX_NESTING )
+		return (*this).fail(ParseErr::TOO_DEEP, token_.position);
+	
+	if ( not (*this).parseUnary() )
+		return false;
+	
+	while ( precedence(token_) >= minimum ) {
+		char symbol = token_.symbol;
+		int level = precedence(token_);
 		
-	else if ( int(expressionToEval.find("*")) != -1 )
-		result = evalMultiplication(expressionToEval);
+		if ( not (*this).advance() )
+			return false;
 		
-	else if ( int(expressionToEval.find("/")) != -1 )
-		result = evalDivision(expressionToEval);
+		// '^' is right associative.
+		if ( not (*this).parseBinary(symbol == '^' ? level : level + 1) )
+			return false;
 		
+		OpCode code = POWER;
+		switch ( symbol ) {
+			case '+': code = ADD;      break;
+			case '-': code = SUBTRACT; break;
+			case '*': code = MULTIPLY; break;
+			case '/': code = DIVIDE;   break;
+		}
+		
+		if ( not builder_.apply(code) )
+			return (*this).fail(ParseErr::TOO_DEEP, token_.position);
+	}
+	
+	nesting_--;
+	
+	return true;
+}
+
+
+// Unary signs bind looser than '^', so that -2^2 is -4.
+template <class Builder>
+constexpr bool Parsing::Parser<Builder>::parseUnary ( )
+{
+	if (
+		token_.type != OPERATOR or
+		( token_.symbol != '-' and token_.symbol != '+' ) )
+		return (*this).parsePrimary();
+	
+	bool isNegated = token_.symbol == '-';
+	
+	// The operand of a sign takes the '^' that follows it.
+	if ( not (*this).advance() or not (*this).parseBinary(POWER_PRECEDENCE) )
+		return false;
+	
+	if ( isNegated and not builder_.apply(NEGATE) )
+		return (*this).fail(ParseErr::TOO_DEEP, token_.position);
+	
+	return true;
+}
+
+
+template <class Builder>
+constexpr bool Parsing::Parser<Builder>::parsePrimary ( )
+{
+	if ( token_.type == NUMBER ) {
+		if ( not builder_.push(token_.value) )
+			return (*this).fail(ParseErr::TOO_DEEP, token_.position);
+		
+		return (*this).advance();
+	}
+	
+	if ( token_.type == LEFT_PARENTHESIS ) {
+		int opening = token_.position;
+		
+		if ( not (*this).advance() or not (*this).parseBinary(1) )
+			return false;
+		
+		if ( token_.type != RIGHT_PARENTHESIS )
+			return (*this).fail(ParseErr::PARENTHESIS, opening);
+		
+		return (*this).advance();
+	}
+	
+	if ( token_.type != IDENTIFIER )
+		return (*this).fail(ParseErr::OPERAND, token_.position);
+	
+	string_view name = lexer_.text(token_);
+	
+	int variable = builder_.find(name);
+	if ( variable >= 0 ) {
+		if ( not builder_.load(variable) )
+			return (*this).fail(ParseErr::TOO_DEEP, token_.position);
+		
+		return (*this).advance();
+	}
+	
+	if ( name.substr(0, 7) == "Const::" )
+		name.remove_prefix(7);
+	
+	for ( const NamedConstant& constant : constants )
+		if ( name == constant.name ) {
+			if ( not builder_.push(constant.value) )
+				return (*this).fail(ParseErr::TOO_DEEP, token_.position);
+		
+			return (*this).advance();
+		}
+	
+	for ( const NamedFunction& function : functions )
+		if ( name == function.name ) {
+			int position = token_.position;
+		
+			if ( not (*this).advance() )
+				return false;
+			if ( token_.type != LEFT_PARENTHESIS )
+				return (*this).fail(ParseErr::PARENTHESIS, position);
+		
+			if ( not (*this).parsePrimary() )
+				return false;
+			if ( not builder_.call(function.function) )
+				return (*this).fail(ParseErr::TOO_DEEP, position);
+		
+			return true;
+		}
+	
+	return (*this).fail(ParseErr::IDENTIFIER, token_.position);
+}
+
+
+template <class Builder>
+constexpr bool Parsing::Parser<Builder>::advance ( )
+{
+	ParseErr::Code code = lexer_.next(token_);
+	
+	if ( code != ParseErr::NONE )
+		return (*this).fail(code, token_.position);
+	
+	return true;
+}
+
+
+// Records the first error. Always returns false.
+template <class Builder>
+constexpr bool Parsing::Parser<Builder>::fail ( ParseErr::Code code,
+                                                int            position )
+{
+	if ( error_ == ParseErr::NONE ) {
+		error_ = code;
+		position_ = position;
+	}
+	
+	return false;
+}
+
+
+template <class Builder>
+constexpr int Parsing::Parser<Builder>::precedence ( const Token& token )
+{
+	if ( token.type != OPERATOR )
+		return 0;
+	
+	switch ( token.symbol ) {
+		case '+': case '-': return 1;
+		case '*': case '/': return 2;
+		default:            return POWER_PRECEDENCE;
+	}
+}
+
+//}
+
+
+//{ Parsing::Calculator
+
+constexpr Parsing::Calculator::Calculator ( )
+	: stack_(), top_(-1)
+{
+}
+
+
+constexpr bool Parsing::Calculator::push ( double value )
+{
+	if ( top_ + 1 >= MAX_STACK_DEPTH )
+		return false;
+	
+	stack_[++top_] = value;
+	
+	return true;
+}
+
+
+// The calculator has no variables.
+constexpr bool Parsing::Calculator::load ( int )
+{
+	return false;
+}
+
+
+constexpr bool Parsing::Calculator::apply ( OpCode code )
+{
+	if ( code == NEGATE )
+		stack_[top_] = -stack_[top_];
 	else {
-		stringstream streamExpression;
-		streamExpression << expressionToEval;
-		streamExpression >> result;
+		top_--;
+		stack_[top_] = binaryOperation(code, stack_[top_], stack_[top_ + 1]);
 	}
 	
-	return result;
+	return true;
 }
 
 
-void parseExpression ( string expression, string operation,
-					   double& number1, double& number2 )
+constexpr bool Parsing::Calculator::call ( double (*function) ( double ) )
+{
+	stack_[top_] = function(stack_[top_]);
+	
+	return true;
+}
+
+
+constexpr int Parsing::Calculator::find ( string_view ) const
+{
+	return -1;
+}
+
+
+constexpr double Parsing::Calculator::getResult ( ) const
+{
+	return stack_[0];
+}
+
+
+constexpr bool Parsing::isBlank ( char character )
+{
+	return character == ' ' or ( character >= '\t' and character <= '\r' );
+}
+
+
+constexpr bool Parsing::isDigit ( char character )
+{
+	return character >= '0' and character <= '9';
+}
+
+
+constexpr bool Parsing::isLetter ( char character )
+{
+	return
+		( character >= 'a' and character <= 'z' ) or
+		( character >= 'A' and character <= 'Z' ) or character == '_';
+}
+
+
+// Reads the number at the start of a text. from_chars is not available at
+// compile time, where the digits are accumulated instead; the result is
+// exact for up to 15 significant digits and an exponent of at most 22.
+constexpr ParseErr::Code Parsing::scanNumber ( string_view text, double& value,
+                                               int& length )
+{
+	if ( not GALLICA_IS_CONSTANT_EVALUATED() ) {
+		from_chars_result conversion = from_chars(text.data(),
+		                                          text.data() + text.size(),
+		                                          value);
+		if ( conversion.ec != errc() )
+			return ParseErr::NUMBER;
+		
+		length = int(conversion.ptr - text.data());
+		
+		return ParseErr::NONE;
+	}
+	
+	int size = int(text.size());
+	int i = 0;
+	int digits = 0;
+	int exponent = 0;
+	double mantissa = 0.0;
+	
+	for ( ; i < size and isDigit(text[i]); i ++, digits ++ )
+		mantissa = mantissa * 10.0 + (text[i] - '0');
+	
+	if ( i < size and text[i] == '.' )
+		for ( i ++; i < size and isDigit(text[i]); i ++, digits ++ ) {
+			mantissa = mantissa * 10.0 + (text[i] - '0');
+			exponent--;
+		}
+	
+	if ( digits == 0 )
+		return ParseErr::NUMBER;
+	
+	// Like from_chars, an exponent without digits is not part of the number.
+	if ( i < size and ( text[i] == 'e' or text[i] == 'E' ) ) {
+		int j = i + 1;
+		bool isNegative = false;
+		if ( j < size and ( text[j] == '+' or text[j] == '-' ) )
+			isNegative = text[j++] == '-';
+		
+		if ( j < size and isDigit(text[j]) ) {
+			int written = 0;
+			for ( ; j < size and isDigit(text[j]); j ++ )
+				if ( written < 10000 )
+					written = written * 10 + (text[j] - '0');
+			
+			exponent += isNegative ? -written : written;
+			i = j;
+		}
+	}
+	
+	double scale = 1.0;
+	for ( int k = 0; k < exponent or k < -exponent; k ++ )
+		scale *= 10.0;
+	
+	value = exponent < 0 ? mantissa / scale : mantissa * scale;
+	length = i;
+	
+	return ParseErr::NONE;
+}
+
+
+// At compile time, only integer exponents can be evaluated.
+constexpr double Parsing::power ( double base, double exponent )
+{
+	if ( not GALLICA_IS_CONSTANT_EVALUATED() or exponent != int(exponent) )
+		return pow(base, exponent);
+	
+	double result = 1.0;
+	double factor = base;
+	
+	for ( int n = exponent < 0 ? -int(exponent) : int(exponent); n > 0;
+	      n /= 2 ) {
+		if ( n % 2 == 1 )
+			result *= factor;
+		factor *= factor;
+	}
+	
+	return exponent < 0 ? 1.0 / result : result;
+}
+
+
+constexpr double Parsing::binaryOperation ( OpCode code, double left,
+                                            double right )
+{
+	switch ( code ) {
+		case ADD:      return left + right;
+		case SUBTRACT: return left - right;
+		case MULTIPLY: return left * right;
+		case DIVIDE:   return left / right;
+		default:       return power(left, right);
+	}
+}
+
+//}
+
+
+//{ Expression
+
+Expression::Expression ( )
+{
+	depth_ = 0;
+	maxDepth_ = 0;
+	
+	(*this).push(0.0);
+}
+
+
+Expression::Expression ( string_view text, const vector<string>& variables )
+{
+	(*this).compile(text, variables);
+}
+
+
+void Expression::compile ( string_view text, const vector<string>& variables )
+{
+	program_.clear();
+	variables_ = variables;
+	depth_ = 0;
+	maxDepth_ = 0;
+	
+	Parsing::Parser<Expression> parser(text, *this);
+	ParseErr::Code code = parser.parse();
+	
+	if ( code != ParseErr::NONE )
+		throw ParseError(code, parser.getPosition());
+}
+
+
+double Expression::evaluate ( const double* values ) const
+{
+	double stack[Parsing::MAX_STACK_DEPTH];
+	int top = -1;
+	
+	for ( const Instruction& instruction : program_ ) {
+		switch ( instruction.code ) {
+			case Parsing::PUSH:
+				stack[++top] = instruction.value;
+				break;
+			case Parsing::LOAD:
+				stack[++top] = values[instruction.variable];
+				break;
+			case Parsing::NEGATE:
+				stack[top] = -stack[top];
+				break;
+			case Parsing::CALL:
+				stack[top] = instruction.function(stack[top]);
+				break;
+			default: {
+				double right = instruction.isImmediate ? instruction.value :
+				                                         stack[top--];
+				stack[top] = Parsing::binaryOperation(instruction.code,
+				                                      stack[top], right);
+				break;
+			}
+		}
+	}
+	
+	return stack[0];
+}
+
+
+// Evaluates the expression for every lane of structure of arrays inputs :
+// results[i] uses inputs[v][i] as the value of variable v.
+void Expression::evaluate ( int count, const double* const* inputs,
+                            double* results ) const
+{
+	vector<double> stack(size_t(maxDepth_) * Parsing::BATCH_BLOCK);
+	
+	for ( int first = 0; first < count; first += Parsing::BATCH_BLOCK ) {
+		int lanes = min(Parsing::BATCH_BLOCK, count - first);
+		
+		(*this).evaluateBlock(first, lanes, inputs, results + first,
+		                      stack.data());
+	}
+}
+
+
+int Expression::getSize ( ) const
+{
+	return int(program_.size());
+}
+
+
+int Expression::getVariableCount ( ) const
+{
+	return int(variables_.size());
+}
+
+
+bool Expression::push ( double value )
+{
+	if ( depth_ + 1 > Parsing::MAX_STACK_DEPTH )
+		return false;
+	
+	Instruction instruction = {Parsing::PUSH, value, -1, NULL, false};
+	program_.push_back(instruction);
+	maxDepth_ = max(maxDepth_, ++depth_);
+	
+	return true;
+}
+
+
+bool Expression::load ( int variable )
+{
+	if ( depth_ + 1 > Parsing::MAX_STACK_DEPTH )
+		return false;
+	
+	Instruction instruction = {Parsing::LOAD, 0.0, variable, NULL, false};
+	program_.push_back(instruction);
+	maxDepth_ = max(maxDepth_, ++depth_);
+	
+	return true;
+}
+
+
+// Operations on constants are folded right away.
+bool Expression::apply ( Parsing::OpCode code )
 {
-	string str1, str2;
-	str1 = str2 = expression;
-	str1.resize(expression.find(operation));
-	str2.erase(0, expression.find(operation) + 1);
+	int size = int(program_.size());
+	
+	Instruction& last = program_[size - 1];
+	
+	if ( code == Parsing::NEGATE ) {
+		if ( last.code == Parsing::PUSH )
+			last.value = -last.value;
+		else {
+			Instruction instruction = {code, 0.0, -1, NULL, false};
+			program_.push_back(instruction);
+		}
+		
+		return true;
+	}
+	
+	// A constant right operand becomes an immediate of the operation.
+	if ( last.code == Parsing::PUSH ) {
+		if ( size >= 2 and program_[size - 2].code == Parsing::PUSH ) {
+			program_[size - 2].value = Parsing::binaryOperation(
+				code, program_[size - 2].value, last.value);
+			program_.pop_back();
+		}
+		else {
+			last.code = code;
+			last.isImmediate = true;
+		}
+	}
+	else {
+		Instruction instruction = {code, 0.0, -1, NULL, false};
+		program_.push_back(instruction);
+	}
+	
+	depth_--;
+	
+	return true;
+}
+
 
-	stringstream conversion;
+bool Expression::call ( double (*function) ( double ) )
+{
+	int size = int(program_.size());
 	
-	conversion << str1;
-	conversion >> number1;
-	conversion.str("");
+	if ( program_[size - 1].code == Parsing::PUSH )
+		program_[size - 1].value = function(program_[size - 1].value);
+	else {
+		Instruction instruction = {Parsing::CALL, 0.0, -1, function, false};
+		program_.push_back(instruction);
+	}
+	
+	return true;
+}
+
+int Expression::find ( string_view name ) const
+{
+	for ( int v = 0; v < int(variables_.size()); v ++ )
+		if ( name == variables_[v] )
+			return v;
+	
+	return -1;
+}
+
+
+// Runs the program once for up to BATCH_BLOCK lanes, on a stack of rows of
+// BATCH_BLOCK values. Every instruction works on a whole row, in loops the
+// compiler turns into SIMD code for the arithmetic operations.
+void Expression::evaluateBlock ( int first, int lanes,
+                                 const double* const* inputs,
+                                 double* results, double* stack ) const
+{
+	const int BLOCK = Parsing::BATCH_BLOCK;
+	int top = -1;
+	
+	for ( const Instruction& instruction : program_ ) {
+		Parsing::OpCode code = instruction.code;
+		
+		if ( code == Parsing::PUSH ) {
+			double* row = stack + ++top * BLOCK;
+			double value = instruction.value;
+			for ( int i = 0; i < lanes; i ++ )
+				row[i] = value;
+		}
+		
+		else if ( code == Parsing::LOAD ) {
+			double* row = stack + ++top * BLOCK;
+			const double* source = inputs[instruction.variable] + first;
+			for ( int i = 0; i < lanes; i ++ )
+				row[i] = source[i];
+		}
+		
+		else if ( code == Parsing::NEGATE ) {
+			double* row = stack + top * BLOCK;
+			for ( int i = 0; i < lanes; i ++ )
+				row[i] = -row[i];
+		}
+		
+		else if ( code == Parsing::CALL ) {
+			double* row = stack + top * BLOCK;
+			for ( int i = 0; i < lanes; i ++ )
+				row[i] = instruction.function(row[i]);
+		}
+		
+		else if ( instruction.isImmediate ) {
+			double* left = stack + top * BLOCK;
+			double right = instruction.value;
+			
+			switch ( code ) {
+				case Parsing::ADD:
+					for ( int i = 0; i < lanes; i ++ )
+						left[i] += right;
+					break;
+				case Parsing::SUBTRACT:
+					for ( int i = 0; i < lanes; i ++ )
+						left[i] -= right;
+					break;
+				case Parsing::MULTIPLY:
+					for ( int i = 0; i < lanes; i ++ )
+						left[i] *= right;
+					break;
+				case Parsing::DIVIDE:
+					for ( int i = 0; i < lanes; i ++ )
+						left[i] /= right;
+					break;
+				default:
+					for ( int i = 0; i < lanes; i ++ )
+						left[i] = pow(left[i], right);
+					break;
+			}
+		}
+		
+		else {
+			top--;
+			double* __restrict left = stack + top * BLOCK;
+			const double* __restrict right = left + BLOCK;
+			
+			switch ( code ) {
+				case Parsing::ADD:
+					for ( int i = 0; i < lanes; i ++ )
+						left[i] += right[i];
+					break;
+				case Parsing::SUBTRACT:
+					for ( int i = 0; i < lanes; i ++ )
+						left[i] -= right[i];
+					break;
+				case Parsing::MULTIPLY:
+					for ( int i = 0; i < lanes; i ++ )
+						left[i] *= right[i];
+					break;
+				case Parsing::DIVIDE:
+					for ( int i = 0; i < lanes; i ++ )
+						left[i] /= right[i];
+					break;
+				default:
+					for ( int i = 0; i < lanes; i ++ )
+						left[i] = pow(left[i], right[i]);
+					break;
+			}
+		}
+	}
+	
+	for ( int i = 0; i < lanes; i ++ )
+		results[i] = stack[i];
+}
+
+//}
+
+
+//{ ExpressionCache
+
+ExpressionCache::ExpressionCache ( size_t capacity )
+{
+	capacity_ = capacity;
+	hits_ = 0;
+	misses_ = 0;
+}
+
+
+// Same as ::eval(string_view), throwing ParseError on malformed texts, which
+// are not remembered.
+double ExpressionCache::eval ( string_view text )
+{
+	key_.assign(text.data(), text.size());
+	
+	unordered_map<string, double>::const_iterator found = values_.find(key_);
+	if ( found != values_.end() ) {
+		hits_++;
+		return found->second;
+	}
+	
+	misses_++;
+	
+	double value = ::eval(text);
+	if ( values_.size() < capacity_ )
+		values_.emplace(key_, value);
+	
+	return value;
+}
+
+
+void ExpressionCache::clear ( )
+{
+	values_.clear();
+	hits_ = 0;
+	misses_ = 0;
+}
+
+
+size_t ExpressionCache::getHits ( ) const
+{
+	return hits_;
+}
+
+
+size_t ExpressionCache::getMisses ( ) const
+{
+	return misses_;
+}
+
+
+double ExpressionCache::getHitRate ( ) const
+{
+	if ( hits_ + misses_ == 0 )
+		return 0.0;
+	
+	return double(hits_) / double(hits_ + misses_);
+}
+
+
+size_t ExpressionCache::getSize ( ) const
+{
+	return values_.size();
+}
+
+//}
+
+
+//{ Functions
+
+ParseErr::Code eval ( string_view expression, double& result )
+{
+	if ( parseNumber(expression, result) == ParseErr::NONE )
+		return ParseErr::NONE;
+	
+	Parsing::Calculator calculator;
+	Parsing::Parser<Parsing::Calculator> parser(expression, calculator);
+	
+	ParseErr::Code code = parser.parse();
+	if ( code == ParseErr::NONE )
+		result = calculator.getResult();
+	
+	return code;
+}
+
+
+// A plain number, with optional surrounding blanks and sign.
+ParseErr::Code parseNumber ( string_view text, double& result )
+{
+	while ( not text.empty() and isspace((unsigned char)text.front()) )
+		text.remove_prefix(1);
+	while ( not text.empty() and isspace((unsigned char)text.back()) )
+		text.remove_suffix(1);
+	
+	if ( text.empty() )
+		return ParseErr::EMPTY;
+	
+	if ( text.front() == '+' )
+		text.remove_prefix(1);
+	
+	// from_chars also reads "inf" and "nan", which the grammar doesn't have :
+	// like a number token, the text must start with a digit or a point.
+	size_t first = text.front() == '-' ? 1 : 0;
+	if (
+		first == text.size() or
+		not ( Parsing::isDigit(text[first]) or text[first] == '.' ) )
+		return ParseErr::NUMBER;
+	
+	double value;
+	from_chars_result conversion = from_chars(text.data(),
+	                                          text.data() + text.size(),
+	                                          value);
+	
+	if (
+		conversion.ec != errc() or
+		conversion.ptr != text.data() + text.size() )
+		return ParseErr::NUMBER;
+	
+	result = value;
+	
+	return ParseErr::NONE;
+}
+
+
+GALLICA_CONSTEVAL double evalConstant ( string_view expression )
+{
+	Parsing::Calculator calculator;
+	Parsing::Parser<Parsing::Calculator> parser(expression, calculator);
+	
+	ParseErr::Code code = parser.parse();
+	if ( code != ParseErr::NONE )
+		throw ParseError(code, parser.getPosition());
+	
+	return calculator.getResult();
+}
+
+
+double eval ( string_view expressionToEval )
+{
+	double result;
+	
+	if ( parseNumber(expressionToEval, result) == ParseErr::NONE )
+		return result;
+	
+	Parsing::Calculator calculator;
+	Parsing::Parser<Parsing::Calculator> parser(expressionToEval, calculator);
+	
+	ParseErr::Code code = parser.parse();
+	if ( code != ParseErr::NONE )
+		throw ParseError(code, parser.getPosition());
+	
+	return calculator.getResult();
+}
+
+
+void parseExpression ( string_view expression, string_view operation,
+					   double& number1, double& number2 )
+{
+	size_t split = expression.find(operation);
 	
-	conversion << str2;
-	conversion >> number2;
-	conversion.str("");
+	if ( parseNumber(expression.substr(0, split), number1) != ParseErr::NONE )
+		number1 = 0.0;
+	if ( parseNumber(expression.substr(split + 1), number2) != ParseErr::NONE )
+		number2 = 0.0;
 }
 
 
-double evalAddition ( string addition )
+double evalAddition ( string_view addition )
 {
 	double dou1, dou2;
 	
@@ -99,7 +1229,7 @@ double evalAddition ( string addition )
 }
 
 
-double evalSubstraction ( string substraction )
+double evalSubstraction ( string_view substraction )
 {
 	double dou1, dou2;
 	
@@ -109,7 +1239,7 @@ double evalSubstraction ( string substraction )
 }
 
 
-double evalMultiplication ( string multiplication )
+double evalMultiplication ( string_view multiplication )
 {
 	double dou1, dou2;
 	
@@ -119,7 +1249,7 @@ double evalMultiplication ( string multiplication )
 }
 
 
-double evalDivision ( string division )
+double evalDivision ( string_view division )
 {
 	double dou1, dou2;
 	
@@ -128,3 +1258,4 @@ double evalDivision ( string division )
 	return dou1 / dou2;
 }
 
+//}
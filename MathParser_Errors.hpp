@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : MathParser_Errors.hpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Exception types and handlers for "MathParser.hpp".
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+using namespace std;
+
+
+#include <string>
+#include <ostream>
+
+
+
+
+namespace ParseErr
+{
+	enum Code {NONE,
+	           EMPTY,
+	           CHARACTER,
+	           NUMBER,
+	           IDENTIFIER,
+	           OPERAND,
+	           PARENTHESIS,
+	           TRAILING,
+	           TOO_DEEP};
+
+	const string messages[] = {"No error.",
+	                           "Empty expression.",
+	                           "Unexpected character.",
+	                           "Invalid number.",
+	                           "Unknown constant or function.",
+	                           "Missing operand.",
+	                           "Unbalanced parenthesis.",
+	                           "Unexpected token after expression.",
+	                           "Expression too deeply nested."};
+}
+
+
+
+class ParseError
+{
+public:
+	// Constructors
+	ParseError ( ParseErr::Code, int = -1 );
+	
+	// Non-modifying methods
+	ParseErr::Code getCode ( ) const;
+	           int getPosition ( ) const;
+	          void print ( ostream& );
+	
+protected:
+	// Attributes
+	ParseErr::Code errorCode_;
+	int            position_;  // Offset of the faulty character (-1: unknown).
+	string         errorMessage_;
+};
+
+
+
+
+inline
+ParseError::ParseError ( ParseErr::Code errorCode, int position )
+{
+	errorCode_ = errorCode;
+	position_ = position;
+	errorMessage_ = ParseErr::messages[errorCode];
+}
+
+
+inline
+ParseErr::Code ParseError::getCode ( ) const
+{
+	return errorCode_;
+}
+
+
+inline
+int ParseError::getPosition ( ) const
+{
+	return position_;
+}
+
+
+inline
+void ParseError::print ( ostream& destination )
+{
+	destination << "Expression : " << errorMessage_;
+	
+	if ( position_ >= 0 )
+		destination << " (at " << position_ << ")";
+	
+	destination << "\n";
+}
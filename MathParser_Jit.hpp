@@ -0,0 +1,254 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : MathParser_Jit.hpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Native code generation for compiled expressions of
+//               "MathParser.hpp".
+//     REMARKS : Only on x86-64 Linux, and only for arithmetic : the program
+//               of an Expression is translated to scalar SSE2 instructions,
+//               the evaluation stack living in the registers xmm0 to xmm15.
+//               Expressions with '^' or functions, deeper than 16 values,
+//               or built where the JIT is disabled (GALLICA_NO_JIT, or
+//               NativeExpression::isEnabled set to false) are evaluated by the
+//               interpreter instead.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+using namespace std;
+
+
+//{ Includes
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "MathParser.hpp"
+
+#if defined(__x86_64__) and defined(__linux__) and not defined(GALLICA_NO_JIT)
+	#define GALLICA_JIT
+	#include <sys/mman.h>
+#endif
+
+//}
+
+
+//{ Declarations
+
+// An Expression with native code for its program. Instances are not
+// copyable, as they own their executable pages.
+class NativeExpression
+{
+public:
+	// Static attributes
+	static bool isEnabled;  // Checked when native code is generated.
+	
+	// Constructor and destructor
+	NativeExpression ( const Expression& );
+	NativeExpression ( const NativeExpression& ) = delete;
+	~NativeExpression ( );
+	
+	NativeExpression& operator= ( const NativeExpression& ) = delete;
+	
+	// Non-modifying methods
+	double evaluate ( const double* = NULL ) const;
+	  bool isNative ( ) const;
+	
+protected:
+	// Code generation methods
+	bool generate ( );
+	
+	static void emitOpcode ( vector<uint8_t>&, uint8_t, uint8_t, int, int = 0 );
+	static void emitInteger ( vector<uint8_t>&, int32_t );
+	
+	// Attributes
+	Expression expression_;  // Interpreted when there is no native code.
+	void*      code_;
+	size_t     codeSize_;
+	double     (*function_) ( const double* );
+};
+
+bool NativeExpression::isEnabled = true;
+
+//}
+
+
+//##############################################################################
+
+
+//{ NativeExpression
+
+NativeExpression::NativeExpression ( const Expression& expression )
+	: expression_(expression)
+{
+	code_ = NULL;
+	codeSize_ = 0;
+	function_ = NULL;
+	
+	if ( isEnabled )
+		(*this).generate();
+}
+
+
+NativeExpression::~NativeExpression ( )
+{
+	#ifdef GALLICA_JIT
+	if ( code_ != NULL )
+		munmap(code_, codeSize_);
+	#endif
+}
+
+
+double NativeExpression::evaluate ( const double* values ) const
+{
+	if ( function_ != NULL )
+		return function_(values);
+	
+	return expression_.evaluate(values);
+}
+
+
+bool NativeExpression::isNative ( ) const
+{
+	return function_ != NULL;
+}
+
+
+// Translates the program to a function double ( const double* values ), in
+// the System V calling convention : values in rdi, result in xmm0. The value
+// at depth k of the evaluation stack is held in xmmk. Constants follow the
+// code in a pool that starts with the sign mask used by NEGATE, and are
+// addressed relative to rip.
+bool NativeExpression::generate ( )
+{
+	#ifndef GALLICA_JIT
+	return false;
+	#else
+	const int REGISTERS = 16;
+	
+	vector<uint8_t> code;
+	vector<double> pool = {-0.0, -0.0};  // 16 bytes, aligned for xorpd.
+	vector<int> displacements;           // Code offsets of rip operands,
+	vector<int> targets;                 // and the pool offsets they load.
+	int top = -1;
+	
+	for ( const Expression::Instruction& instruction : expression_.program_ ) {
+		Parsing::OpCode operation = instruction.code;
+		
+		// Opcodes of addsd, subsd, mulsd and divsd.
+		uint8_t arithmetic = 0;
+		switch ( operation ) {
+			case Parsing::ADD:      arithmetic = 0x58; break;
+			case Parsing::SUBTRACT: arithmetic = 0x5C; break;
+			case Parsing::MULTIPLY: arithmetic = 0x59; break;
+			case Parsing::DIVIDE:   arithmetic = 0x5E; break;
+			default:                                   break;
+		}
+		
+		if ( operation == Parsing::POWER or operation == Parsing::CALL )
+			return false;
+		
+		// The depth is counted on the program : maxDepth_ also counts the
+		// constants that were folded into immediates.
+		if (
+			( operation == Parsing::LOAD or operation == Parsing::PUSH ) and
+			top + 1 >= REGISTERS )
+			return false;
+		
+		// movsd xmm(top), [rdi + 8 * variable]
+		else if ( operation == Parsing::LOAD ) {
+			top++;
+			emitOpcode(code, 0xF2, 0x10, top);
+			code.push_back(0x87 | (top & 7) << 3);
+			emitInteger(code, 8 * instruction.variable);
+		}
+		
+		// op xmm(top), xmm(top + 1)
+		else if ( arithmetic != 0 and not instruction.isImmediate ) {
+			top--;
+			emitOpcode(code, 0xF2, arithmetic, top, top + 1);
+			code.push_back(0xC0 | (top & 7) << 3 | ((top + 1) & 7));
+		}
+		
+		// movsd xmm(top), [constant], op xmm(top), [constant] or
+		// xorpd xmm(top), [sign mask]
+		else {
+			if ( operation == Parsing::PUSH )
+				emitOpcode(code, 0xF2, 0x10, ++top);
+			else if ( operation == Parsing::NEGATE )
+				emitOpcode(code, 0x66, 0x57, top);
+			else
+				emitOpcode(code, 0xF2, arithmetic, top);
+			
+			code.push_back(0x05 | (top & 7) << 3);
+			displacements.push_back(int(code.size()));
+			emitInteger(code, 0);
+			
+			if ( operation == Parsing::NEGATE )
+				targets.push_back(0);
+			else {
+				targets.push_back(int(pool.size() * sizeof(double)));
+				pool.push_back(instruction.value);
+			}
+		}
+	}
+	
+	code.push_back(0xC3);  // ret
+	
+	int poolStart = (int(code.size()) + 15) / 16 * 16;
+	for ( int k = 0; k < int(displacements.size()); k ++ ) {
+		int32_t displacement = poolStart + targets[k] - (displacements[k] + 4);
+		memcpy(&code[displacements[k]], &displacement, 4);
+	}
+	
+	codeSize_ = poolStart + pool.size() * sizeof(double);
+	void* pages = mmap(NULL, codeSize_, PROT_READ | PROT_WRITE,
+	                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ( pages == MAP_FAILED )
+		return false;
+	
+	memcpy(pages, code.data(), code.size());
+	memcpy((uint8_t*)pages + poolStart, pool.data(),
+	       pool.size() * sizeof(double));
+	
+	// The pages are never writable and executable at the same time.
+	if ( mprotect(pages, codeSize_, PROT_READ | PROT_EXEC) != 0 ) {
+		munmap(pages, codeSize_);
+		return false;
+	}
+	
+	code_ = pages;
+	function_ = reinterpret_cast<double (*) ( const double* )>(pages);
+	
+	return true;
+	#endif
+}
+
+
+// Prefix, REX (when a register is above xmm7) and two byte opcode of an SSE2
+// instruction whose ModRM reg field is the register "reg" and, for a
+// register to register form, whose r/m field is "rm".
+void NativeExpression::emitOpcode ( vector<uint8_t>& code, uint8_t prefix,
+                                    uint8_t opcode, int reg, int rm )
+{
+	code.push_back(prefix);
+	
+	if ( reg >= 8 or rm >= 8 )
+		code.push_back(0x40 | (reg >= 8) << 2 | (rm >= 8));
+	
+	code.push_back(0x0F);
+	code.push_back(opcode);
+}
+
+
+void NativeExpression::emitInteger ( vector<uint8_t>& code, int32_t value )
+{
+	uint8_t bytes[4];
+	memcpy(bytes, &value, 4);
+	
+	code.insert(code.end(), bytes, bytes + 4);
+}
+
+//}
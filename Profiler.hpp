@@ -0,0 +1,431 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : Profiler.hpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Scoped profiling zones, with an export to the Chrome trace
+//               format and a percentile summary per zone.
+//     REMARKS : All classes and functions in this library are under the
+//               namespace 'Profiling'. Zones are opened with the macro
+//               GALLICA_PROFILE_ZONE, which expands to nothing when
+//               GALLICA_NO_PROFILING is defined.
+//               Every thread records in its own ring buffer without locking.
+//               On x86 with GCC or Clang, zones are timed with the TSC, which
+//               is cheaper to read than steady_clock, and converted to
+//               nanoseconds at export; this assumes an invariant TSC. Define
+//               GALLICA_NO_TSC to time them with steady_clock instead.
+//               The export functions read the buffers of all threads and are
+//               meant to be called when those are done recording, e.g. at
+//               exit : a zone recorded during an export may be missed.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+using namespace std;
+
+
+//{ Includes
+
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+
+#if (defined(__x86_64__) or defined(__i386__)) and defined(__GNUC__) \
+    and not defined(GALLICA_NO_TSC)
+	#define GALLICA_PROFILE_TSC
+	#include <x86intrin.h>
+#endif
+
+#define GALLICA_CONCAT_IMPL(first, second) first##second
+#define GALLICA_CONCAT(first, second) GALLICA_CONCAT_IMPL(first, second)
+
+#ifndef GALLICA_NO_PROFILING
+	#define GALLICA_PROFILE_ZONE(name) \
+		Profiling::Zone GALLICA_CONCAT(profilingZone_, __LINE__)(name)
+#else
+	#define GALLICA_PROFILE_ZONE(name)
+#endif
+
+//}
+
+
+namespace Profiling
+{
+
+//{ Declarations
+
+//{ Constants
+
+const int BUFFER_CAPACITY = 1 << 16;  // Latest zones kept per thread.
+
+//}
+
+
+//{ Structures
+
+struct ZoneRecord
+{
+	const char* name;      // Must outlive the export, e.g. a string literal.
+	   int64_t start;      // Ticks of the profiling clock
+	   int64_t duration;
+};
+
+//}
+
+
+//{ Classes
+
+// Forward declarations
+class ThreadBuffer; class Zone; class Registry;
+
+
+// The zones recorded by one thread. Only that thread writes in the buffer;
+// the count is published with release ordering for the readers.
+class ThreadBuffer
+{
+public:
+	// Constructor
+	ThreadBuffer ( int );
+	
+	// Modifying methods
+	void record ( const char*, int64_t, int64_t );
+	
+	// Non-modifying methods
+	 int getThreadId ( ) const;
+	void collect ( vector<ZoneRecord>& ) const;  // Oldest zone first.
+	
+protected:
+	// Attributes
+	  vector<ZoneRecord> records_;
+	    atomic<uint64_t> count_;
+	                 int threadId_;
+};
+
+
+// Records the time between its construction and its destruction in the
+// buffer of the current thread.
+class Zone
+{
+public:
+	// Constructor and destructor
+	Zone ( const char* );
+	Zone ( const Zone& ) = delete;
+	~Zone ( );
+	
+	Zone& operator= ( const Zone& ) = delete;
+	
+protected:
+	// Attributes
+	const char* name_;
+	    int64_t start_;
+};
+
+
+// The buffers of every thread that has recorded a zone. They are kept after
+// their thread ends, until the export at exit.
+class Registry
+{
+public:
+	// Constructor
+	Registry ( );
+	
+	// Attributes
+	mutex                            lock;
+	vector<unique_ptr<ThreadBuffer>> buffers;
+	int64_t                          startTicks;  // Reference for conversions
+	int64_t                          startTime;   // to nanoseconds
+};
+
+//}
+
+
+//{ Functions
+
+      int64_t now ( );
+      int64_t ticks ( );
+       double getTickPeriod ( );
+    Registry& getRegistry ( );
+ThreadBuffer& getThreadBuffer ( );
+
+void writeChromeTrace ( ostream& );
+bool exportChromeTrace ( const string& );
+void printSummary ( ostream& );
+
+//}
+
+//}
+
+
+
+
+//{ ThreadBuffer
+
+//{ ThreadBuffer::Constructor
+
+inline
+ThreadBuffer::ThreadBuffer ( int threadId ) : records_(BUFFER_CAPACITY),
+                                              count_(0)
+{
+	threadId_ = threadId;
+}
+
+//}
+
+
+//{ ThreadBuffer::Modifying methods
+
+// The oldest zone is overwritten when the buffer is full.
+inline
+void ThreadBuffer::record ( const char* name, int64_t start, int64_t duration )
+{
+	uint64_t count = count_.load(memory_order_relaxed);
+	
+	ZoneRecord& destination = records_[count % BUFFER_CAPACITY];
+	destination.name = name;
+	destination.start = start;
+	destination.duration = duration;
+	
+	count_.store(count + 1, memory_order_release);
+}
+
+//}
+
+
+//{ ThreadBuffer::Non-modifying methods
+
+inline
+int ThreadBuffer::getThreadId ( ) const
+{
+	return threadId_;
+}
+
+
+void ThreadBuffer::collect ( vector<ZoneRecord>& destination ) const
+{
+	uint64_t count = count_.load(memory_order_acquire);
+	uint64_t first = count > uint64_t(BUFFER_CAPACITY) ?
+	                 count - BUFFER_CAPACITY : 0;
+	
+	for ( uint64_t i = first; i < count; i ++ )
+		destination.push_back(records_[i % BUFFER_CAPACITY]);
+}
+
+//}
+
+//}
+
+
+//{ Zone
+
+inline
+Zone::Zone ( const char* name )
+{
+	name_ = name;
+	start_ = ticks();
+}
+
+
+inline
+Zone::~Zone ( )
+{
+	int64_t end = ticks();
+	
+	getThreadBuffer().record(name_, start_, end - start_);
+}
+
+//}
+
+
+//{ Functions
+
+inline
+int64_t now ( )
+{
+	return chrono::duration_cast<chrono::nanoseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Reading of the clock used by the zones.
+inline
+int64_t ticks ( )
+{
+#ifdef GALLICA_PROFILE_TSC
+	return int64_t(__rdtsc());
+#else
+	return now();
+#endif
+}
+
+
+// Nanoseconds per tick, measured over the time since the first zone.
+double getTickPeriod ( )
+{
+#ifdef GALLICA_PROFILE_TSC
+	Registry& registry = getRegistry();
+	
+	int64_t elapsedTicks = ticks() - registry.startTicks;
+	int64_t elapsedTime = now() - registry.startTime;
+	
+	if ( elapsedTicks <= 0 or elapsedTime <= 0 )
+		return 1.0;
+	
+	return double(elapsedTime) / elapsedTicks;
+#else
+	return 1.0;
+#endif
+}
+
+
+Registry::Registry ( )
+{
+	startTicks = ticks();
+	startTime = now();
+}
+
+
+inline
+Registry& getRegistry ( )
+{
+	static Registry registry;
+	
+	return registry;
+}
+
+
+// Only the first call in a thread takes the registry's lock.
+inline
+ThreadBuffer& getThreadBuffer ( )
+{
+	thread_local ThreadBuffer* buffer = NULL;
+	
+	if ( buffer == NULL ) {
+		Registry& registry = getRegistry();
+		lock_guard<mutex> guard(registry.lock);
+		
+		int threadId = int(registry.buffers.size());
+		registry.buffers.emplace_back(new ThreadBuffer(threadId));
+		buffer = registry.buffers.back().get();
+	}
+	
+	return *buffer;
+}
+
+
+// Complete events ("ph" : "X"), with times in microseconds. The result can
+// be opened in chrome://tracing or Perfetto.
+void writeChromeTrace ( ostream& destination )
+{
+	double tickPeriod = getTickPeriod();
+	
+	Registry& registry = getRegistry();
+	lock_guard<mutex> guard(registry.lock);
+	
+	destination << "{\"traceEvents\":[";
+	
+	bool isFirst = true;
+	vector<ZoneRecord> records;
+	for ( const unique_ptr<ThreadBuffer>& buffer : registry.buffers ) {
+		records.clear();
+		buffer->collect(records);
+		
+		for ( const ZoneRecord& zone : records ) {
+			double start = registry.startTime +
+			               (zone.start - registry.startTicks) * tickPeriod;
+			
+			if ( not isFirst )
+				destination << ",";
+			isFirst = false;
+			
+			destination << "\n{\"name\":\"";
+			for ( const char* c = zone.name; *c != '\0'; c ++ ) {
+				if ( *c == '"' or *c == '\\' )
+					destination << '\\';
+				destination << *c;
+			}
+			destination << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+			            << buffer->getThreadId() << fixed << setprecision(3)
+			            << ",\"ts\":" << start / 1000.0
+			            << ",\"dur\":" << zone.duration * tickPeriod / 1000.0
+			            << "}";
+		}
+	}
+	
+	destination << "\n]}\n";
+}
+
+
+bool exportChromeTrace ( const string& filename )
+{
+	ofstream traceFile(filename);
+	if ( not traceFile )
+		return false;
+	
+	writeChromeTrace(traceFile);
+	
+	return bool(traceFile);
+}
+
+
+// One line per zone name, with durations in microseconds.
+void printSummary ( ostream& destination )
+{
+	double tickPeriod = getTickPeriod();
+	
+	map<string, vector<double>> durations;
+	{
+		Registry& registry = getRegistry();
+		lock_guard<mutex> guard(registry.lock);
+		
+		vector<ZoneRecord> records;
+		for ( const unique_ptr<ThreadBuffer>& buffer : registry.buffers ) {
+			records.clear();
+			buffer->collect(records);
+			
+			for ( const ZoneRecord& zone : records )
+				durations[zone.name].push_back(zone.duration * tickPeriod);
+		}
+	}
+	
+	destination << left << setw(28) << "Zone" << right
+	            << setw(8) << "Count" << setw(10) << "Mean"
+	            << setw(10) << "p50" << setw(10) << "p90"
+	            << setw(10) << "p99" << setw(10) << "Max" << "\n";
+	
+	destination << fixed << setprecision(2);
+	for ( auto& zone : durations ) {
+		vector<double>& times = zone.second;
+		sort(times.begin(), times.end());
+		
+		double sum = 0.0;
+		for ( double time : times )
+			sum += time;
+		
+		int size = int(times.size());
+		auto percentile = [&] ( double rank ) {
+			int index = int(ceil(rank / 100.0 * size)) - 1;
+			return times[max(0, min(index, size - 1))] / 1000.0;
+		};
+		
+		destination << left << setw(28) << zone.first << right
+		            << setw(8) << size << setw(10) << sum / size / 1000.0
+		            << setw(10) << percentile(50.0)
+		            << setw(10) << percentile(90.0)
+		            << setw(10) << percentile(99.0)
+		            << setw(10) << times.back() / 1000.0 << "\n";
+	}
+}
+
+//}
+
+}
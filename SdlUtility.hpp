@@ -16,12 +16,39 @@ using namespace std;
 //{ Includes
 
 #include <string>
+#include <string_view>
 #include <cmath>
+#include <cstdint>
+#include <map>
+#include <list>
+#include <utility>
+#include <ostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <vector>
+#include <algorithm>
 
 #include "SDL/SDL.h"
 #include "SDL/SDL_image.h"
 #include "SDL/SDL_ttf.h"
 
+#if defined(__AVX__)
+	#define GALLICA_COLLISION_AVX
+	#include <immintrin.h>
+#elif defined(__SSE2__) or defined(_M_X64)
+	#define GALLICA_COLLISION_SSE2
+	#include <emmintrin.h>
+#endif
+
+#if defined(__SSE2__) or defined(_M_X64)
+	#define GALLICA_BLEND_SSE2
+	#include <emmintrin.h>
+#endif
+
 //}
 
 
@@ -41,6 +68,14 @@ const uint8_t COLLISION_Y_NEG = exp2(4);
 //}
 
 
+//{ Variables
+
+// Lets applySurface blend 32 bit ARGB surfaces itself (see blendSurface).
+bool isBlendingEnabled = true;
+
+//}
+
+
 //{ Structures
 
 struct Rectangle
@@ -67,15 +102,71 @@ struct CollisionData
 	 uint8_t flags;
 };
 
+
+struct CollisionHit
+{
+	          int circleIndex;
+	          int rectangleIndex;
+	CollisionData data;
+};
+
+
+// The first contact of a moving circle, as found by testSweep().
+struct SweepData
+{
+	double time;     // Fraction of the motion done before the contact
+	double normalX;  // Unit normal of the contact, away from the shape
+	double normalY;
+	  bool isHit;
+};
+
+
+// An image held by the ImageCache.
+struct CachedImage
+{
+	                  string path;
+	            SDL_Surface* surface;
+	                  size_t size;        // Bytes of pixels
+	                     int references;  // Number of handles
+	list<CachedImage*>::iterator unusedPosition;  // Valid without references.
+};
+
+
+struct ImageCacheStatistics
+{
+	   int hits;
+	   int misses;      // Images decoded
+	   int prefetches;  // Misses decoded in advance by the ImageLoader
+	   int evictions;
+	   int imageCount;
+	size_t size;        // Bytes of pixels, including the images in use
+	size_t budget;
+};
+
+
+// A blit waiting in a RenderQueue.
+struct RenderCommand
+{
+	SDL_Surface* source;
+	    SDL_Rect clip;   // Part of the source drawn
+	         int x;      // Position in world coordinates
+	         int y;
+	         int layer;  // Drawn in ascending order
+};
+
 //}
 
 
 //{ Classes
 
 // Forward declarations
-class Timer; class Button; class StringInput;
+class Timer; class ImageHandle; class ImageLoader; class ImageCache;
+class Widget; class Button;
+class StringInput; class FramePacer; class GlyphAtlas; class FontCache;
+class RectangleBatch; class DirtyRegions; class RenderQueue; class EventPump;
 
 
+// Measures elapsed time on the monotonic clock, with nanosecond resolution.
 class Timer
 {
 public:
@@ -89,28 +180,168 @@ public:
 	void unpause ( );
 	
 	// Non-modifying methods
-	bool isStarted ( );
-	bool isPaused ( );
-	 int getTicks ( );
+	   bool isStarted ( );
+	   bool isPaused ( );
+	    int getTicks ( );         // Milliseconds
+	int64_t getNanoseconds ( );
+
+protected:
+	// Static methods
+	static int64_t now ( );
+	
+	// Attributes
+	   bool isStarted_;
+	   bool isPaused_;
+	int64_t startTime_;    // Nanoseconds
+	int64_t pausedTime_;
+};
+
+
+// Decodes image files on worker threads. Only the decoding is done there :
+// the conversion to the display format, which needs the video surface, is
+// left to the main thread. The workers are started by the first request.
+class ImageLoader
+{
+public:
+	// Static methods
+	static shared_future<SDL_Surface*> decode ( const string& );
+	static                        void stop ( );  // Call before SDL_Quit().
+
+protected:
+	typedef packaged_task<SDL_Surface*()> Task;
+	
+	// Static methods
+	static void work ( );
+	
+	// Static attributes
+	static          const int WORKER_COUNT = 2;
+	static     vector<thread> workers_;
+	static        deque<Task> tasks_;      // Waiting for a worker
+	static              mutex lock_;
+	static condition_variable isTaskReady_;
+	static               bool isStopping_;
+};
+vector<thread>           ImageLoader::workers_;
+deque<ImageLoader::Task> ImageLoader::tasks_;
+mutex                    ImageLoader::lock_;
+condition_variable       ImageLoader::isTaskReady_;
+bool                     ImageLoader::isStopping_ = false;
+
+
+// A reference to an image of the ImageCache, which stays loaded as long as
+// a handle to it exists. Handles are only moved; share() makes a new one.
+class ImageHandle
+{
+public:
+	// Constructors and destructor
+	ImageHandle ( );
+	ImageHandle ( ImageHandle&& );
+	ImageHandle ( const ImageHandle& ) = delete;
+	~ImageHandle ( );
+	
+	// Modifying methods
+	void release ( );
+	
+	// Non-modifying methods
+	 ImageHandle share ( ) const;
+	SDL_Surface* getSurface ( ) const;  // NULL for an empty handle.
+	
+	// Modifying operators
+	ImageHandle& operator= ( ImageHandle&& );
+	ImageHandle& operator= ( const ImageHandle& ) = delete;
 
 protected:
+	// Constructor
+	explicit ImageHandle ( CachedImage* );
+	
 	// Attributes
-	bool isStarted_;
-	bool isPaused_;
-	 int startTicks_;
-	 int pausedTicks_;
+	CachedImage* image_;
+	
+	friend class ImageCache;
+};
+
+
+// Loads every image file once, converted to the display format, and shares
+// it between all its handles. The images without handles are kept for
+// later loads and freed, least recently used first, when the images
+// exceed the budget.
+class ImageCache
+{
+public:
+	// Static methods
+	static ImageHandle load ( const string& );  // Empty handle on failure.
+	static        void prefetch ( const string& );
+	static        void setBudget ( size_t );    // Bytes
+	static        void clear ( );               // Frees the unused images.
+	
+	static ImageCacheStatistics getStatistics ( );
+	static                 void printStatistics ( ostream& );
+
+protected:
+	// Static methods
+	static void release ( CachedImage* );
+	static void trim ( );
+	
+	// Static attributes
+	static map<string, CachedImage> images_;
+	static   list<CachedImage*> unusedImages_;  // Most recently used first
+	static map<string, shared_future<SDL_Surface*>> prefetched_;  // Decoding
+	static ImageCacheStatistics statistics_;
+	
+	friend class ImageHandle;
+};
+map<string, CachedImage> ImageCache::images_;
+list<CachedImage*>       ImageCache::unusedImages_;
+map<string, shared_future<SDL_Surface*>> ImageCache::prefetched_;
+ImageCacheStatistics     ImageCache::statistics_ = {0, 0, 0, 0, 0, 0, 64 << 20};
+
+
+// A part of the interface composed once in a surface of its own, then
+// blitted whole until its state changes. Derived classes compose themselves
+// in compose(), and call invalidate() when what they show changes.
+class Widget
+{
+public:
+	// Constructors and destructor
+	Widget ( int, int, int, int );  // Position and size
+	Widget ( const Widget& ) = delete;
+	virtual ~Widget ( );
+	
+	// Modifying methods
+	SDL_Rect apply ( SDL_Surface* );  // Composes if needed, then blits.
+	    void invalidate ( );
+	
+	// Non-modifying methods
+	    bool hasChanged ( ) const;  // Since the last apply
+	SDL_Rect getRect ( ) const;
+	
+	Widget& operator= ( const Widget& ) = delete;
+
+protected:
+	// Modifying methods
+	virtual void compose ( SDL_Surface* ) = 0;  // Draws at the origin.
+	
+	// Position attributes
+	int positionX_;
+	int positionY_;
+	int width_;
+	int height_;
+	
+	// Graphics attributes
+	SDL_Surface* image_;  // In the format of the destination, without alpha
+	        bool isInvalidated_;
 };
 
 
 class Button
 {
 public:
-	// Constructor and Destructor
+	// Constructor
 	Button ( string, int, int, int, int );
-	~Button ( );
 	
 	// Modifying methods
 	void handleInput ( uint8_t, int, int );
+	void apply ( SDL_Surface* );
 	
 	// Non-modifying methods
 	 int getPositionX ( );
@@ -118,9 +349,12 @@ public:
 	 int getHeight ( );
 	 int getWidth ( );
 	bool isClicked ( );
-	void apply ( SDL_Surface* );
+	bool hasChanged ( ) const;  // Whether apply() would draw another clip.
 
 protected:
+	// Non-modifying methods
+	int getClipIndex ( ) const;
+	
 	// Input attributes
 	bool isMouseOver_;
 	bool isPressed_;
@@ -133,62 +367,358 @@ protected:
 	int width_;
 	
 	// Graphics attributes
-	SDL_Surface* spriteSheet_;
-	    SDL_Rect clips_[3];
+	ImageHandle spriteSheet_;
+	   SDL_Rect clips_[3];
+	        int appliedClip_;  // -1 before the first apply
 };
 
 
-class StringInput
+// The text is composed again only when it is edited.
+class StringInput : public Widget
 {
 public:
 	// Constructor
 	StringInput ( SDL_Color, SDL_Color, TTF_Font*, int, int, int );
 	
 	// Modifying methods
-	void activate ( );
-	void deactivate ( );
-	void handleInput ( SDL_Event );
+	    void activate ( );
+	    void deactivate ( );
+	    void handleInput ( SDL_Event );
+	SDL_Rect apply ( SDL_Surface* );  // Draws nothing while inactive.
 	
 	// Non-modifying methods
 	  bool isActive ( );
 	string getText ( );
-	  void apply ( SDL_Surface* );
 
 protected:
+	// Modifying methods
+	void compose ( SDL_Surface* );
+	
 	// Text attributes
 	string text_;
 	
 	// Input attributes
 	bool isActive_;
 	
-	// Position attributes
-	int positionX_;
-	int positionY_;
-	int height_;
-	int width_;
-	
 	// Graphics attributes
 	SDL_Color textColor_;
 	SDL_Color backgroundColor_;
 	TTF_Font* displayFont_;
 };
 
+
+// Paces a loop to a fixed frame rate on a monotonic clock. The thread sleeps
+// for most of every frame and only spins for the last moments, to make up
+// for the coarse wake-ups of the scheduler. A late frame moves the next
+// deadline instead of shortening the frames that follow.
+class FramePacer
+{
+public:
+	// Constructor
+	FramePacer ( double = 60.0, int = 500 );  // Frame rate, spin margin (us).
+	
+	// Modifying methods
+	void start ( );
+	void waitNextFrame ( );
+	void resetStatistics ( );
+	
+	// Non-modifying methods (times in milliseconds)
+	double getAverageFrameTime ( ) const;
+	double getFrameTimePercentile ( double ) const;
+	   int getMissedDeadlines ( ) const;
+	   int getFrameCount ( ) const;
+
+protected:
+	typedef chrono::steady_clock Clock;
+	
+	// Static attributes
+	static const int SAMPLE_COUNT = 1024;  // Latest frames kept for statistics.
+	
+	// Timing attributes
+	   Clock::duration period_;
+	   Clock::duration spinMargin_;
+	 Clock::time_point deadline_;
+	 Clock::time_point frameStart_;
+	              bool isStarted_;
+	
+	// Statistics attributes
+	vector<double> frameTimes_;
+	           int frameCount_;
+	           int missedDeadlines_;
+};
+
+
+// The printable Latin-1 glyphs of a font in one color, rasterized once in a
+// single surface. Text is drawn by blitting the rectangle of every glyph,
+// without allocating; kerning is ignored and control characters are skipped.
+class GlyphAtlas
+{
+public:
+	// Constructor and destructor
+	GlyphAtlas ( TTF_Font*, SDL_Color );
+	GlyphAtlas ( const GlyphAtlas& ) = delete;
+	~GlyphAtlas ( );
+	
+	GlyphAtlas& operator= ( const GlyphAtlas& ) = delete;
+	
+	// Non-modifying methods
+	int apply ( string_view, SDL_Surface*, int, int ) const;  // Returns the
+	int getTextWidth ( string_view ) const;                   // end position.
+	int getHeight ( ) const;
+
+protected:
+	// Static attributes
+	static const int ASCII_GLYPH_COUNT = 95;  // ' ' to '~', then the atlas
+	static const int GLYPH_COUNT = 191;       // goes on with 160 to 255.
+	static const int ATLAS_COLUMNS = 16;
+	
+	// Static methods
+	static int getGlyphIndex ( unsigned char );  // -1 : no glyph.
+	static unsigned char getCharacter ( int );
+	
+	// Attributes
+	SDL_Surface* surface_;
+	    SDL_Rect glyphRects_[GLYPH_COUNT];
+	         int advances_[GLYPH_COUNT];
+	         int height_;
+};
+
+
+// Opens every (file, size) pair of font once for the whole program, and keeps
+// a glyph atlas for every color a font is drawn in. The fonts and atlases are
+// owned by the cache and stay valid until clear().
+class FontCache
+{
+public:
+	// Static methods
+	static   TTF_Font* getFont ( const string&, int );  // NULL on failure.
+	static GlyphAtlas& getAtlas ( TTF_Font*, SDL_Color );
+	static        void clear ( );
+
+protected:
+	// Static attributes
+	static map<pair<string, int>, TTF_Font*>          fonts_;
+	static map<pair<TTF_Font*, uint32_t>, GlyphAtlas*> atlases_;
+};
+map<pair<string, int>, TTF_Font*>          FontCache::fonts_;
+map<pair<TTF_Font*, uint32_t>, GlyphAtlas*> FontCache::atlases_;
+
+
+// The bounds of many rectangles, stored as a structure of arrays so that
+// circles are tested against several of them at once, in the SIMD lanes of
+// AVX (4 lanes) or SSE2 (2 lanes) depending on the target.
+// Large batches are also sorted in a coarse grid, so that a circle is only
+// tested against the rectangles of the cells under it. The grid is rebuilt
+// by the first test after a change, so a batch being changed mustn't be
+// tested from several threads.
+class RectangleBatch
+{
+public:
+	// Static attributes
+	static bool isGridEnabled;  // Checked when the grid is built.
+	
+	// Constructor
+	RectangleBatch ( );
+	
+	// Modifying methods
+	void add ( const Rectangle& );
+	void set ( int, const Rectangle& );
+	void clear ( );
+	
+	// Non-modifying methods
+	      int getSize ( ) const;
+	Rectangle getRectangle ( int ) const;
+	     void testCollisions ( const Circle&, vector<CollisionHit>& ) const;
+	     void testCollisions ( const Circle*, int,
+	                           vector<CollisionHit>& ) const;
+
+protected:
+	// Static attributes
+	static const int GRID_MIN_SIZE = 256;  // Smaller batches are scanned.
+	static const int GRID_CELL_LOAD = 4;   // Rectangles per cell, on average.
+	
+	// Bounds of consecutive rectangles, and their indices in the batch (NULL
+	// when the first one is the rectangle 0 and the others follow).
+	struct Span
+	{
+		const double* left;
+		const double* right;
+		const double* top;
+		const double* bottom;
+		   const int* indices;
+		          int size;
+	};
+	
+	// The rectangles overlapping every cell, cell after cell, by index.
+	struct Grid
+	{
+		     double originX;
+		     double originY;
+		     double cellSize;
+		        int columns;           // 0 : no grid, the batch is scanned.
+		        int rows;
+		vector<int> cellStarts;        // Offsets of the cells in the arrays
+		vector<double> left;           // below, and their end.
+		vector<double> right;
+		vector<double> top;
+		vector<double> bottom;
+		vector<int> indices;
+	};
+	
+	// Non-modifying methods
+	void buildGrid ( ) const;
+	 int getCell ( double, double, int ) const;  // Clamped to [-1, count].
+	void testSpan ( const Circle&, int, const Span&,
+	                vector<CollisionHit>& ) const;
+	void addHits ( const Circle&, int, const Span&, int, int,
+	               vector<CollisionHit>& ) const;
+	
+	// Attributes
+	vector<double> left_;
+	vector<double> right_;
+	vector<double> top_;
+	vector<double> bottom_;
+	  mutable Grid grid_;
+	  mutable bool isGridBuilt_;
+};
+bool RectangleBatch::isGridEnabled = true;
+
+
+// The regions of a screen drawn on during a frame. They are merged when
+// they overlap or touch, and only they are sent to the display. Everything
+// is sent when the whole screen is invalidated or when the regions cover
+// most of it.
+class DirtyRegions
+{
+public:
+	// Constructor
+	DirtyRegions ( int, int );  // Screen size
+	
+	// Modifying methods
+	void add ( SDL_Rect );
+	void invalidate ( );
+	void update ( SDL_Surface* );  // Sends the regions, then clears them.
+	
+	// Non-modifying methods
+	bool isInvalidated ( ) const;
+	 int getUpdatedArea ( ) const;  // Pixels sent by the last update.
+
+protected:
+	// Static attributes
+	static constexpr double FULL_UPDATE_RATIO = 0.5;
+	
+	// Modifying methods
+	void merge ( );
+	
+	// Attributes
+	             int width_;
+	             int height_;
+	            bool isInvalidated_;
+	             int updatedArea_;
+	vector<SDL_Rect> regions_;
+};
+
+
+// The blits of a frame, given in world coordinates. They are drawn together
+// once the frame is described : those outside the viewport are dropped, and
+// the others are drawn by layer, in the order of submission within a layer.
+class RenderQueue
+{
+public:
+	// Constructor
+	RenderQueue ( int, int );  // Viewport size
+	
+	// Modifying methods
+	void setViewport ( int, int );  // World position of the top left corner
+	void submit ( SDL_Surface*, int, int, const SDL_Rect* = NULL, int = 0 );
+	void execute ( SDL_Surface* );  // Draws the commands, then clears them.
+	void clear ( );
+	
+	// Non-modifying methods
+	int getSize ( ) const;
+	int getDrawnCount ( ) const;   // Commands drawn by the last execution
+	int getCulledCount ( ) const;  // and those dropped.
+
+protected:
+	// Attributes
+	                  int viewportX_;
+	                  int viewportY_;
+	                  int width_;
+	                  int height_;
+	                  int drawnCount_;
+	                  int culledCount_;
+	vector<RenderCommand> commands_;
+};
+
+
+// Takes every pending event out of the SDL queue once per frame, and
+// measures the time from the pumping of each input event to the next frame
+// sent to the display. SDL 1.2 doesn't timestamp events : the time they
+// waited in the queue of the system before the pumping isn't counted.
+class EventPump
+{
+public:
+	// Constructor
+	EventPump ( );
+	
+	// Modifying methods
+	const vector<SDL_Event>& pump ( );  // The events since the last pump
+	                void markPresented ( );  // Right after the display update
+	                void resetStatistics ( );
+	
+	// Non-modifying methods (times in milliseconds)
+	double getAverageLatency ( ) const;
+	double getLatencyPercentile ( double ) const;
+	   int getInputCount ( ) const;
+	  void printStatistics ( ostream& ) const;
+
+protected:
+	typedef chrono::steady_clock Clock;
+	
+	// Static attributes
+	static const int SAMPLE_COUNT = 1024;  // Latest inputs kept for statistics.
+	
+	// Static methods
+	static bool isInput ( const SDL_Event& );
+	
+	// Attributes
+	        vector<SDL_Event> events_;
+	vector<Clock::time_point> pendingInputs_;  // Pumped but not yet shown
+	           vector<double> latencies_;
+	                      int inputCount_;
+};
+
 //}
 
 
 //{ Functions
 
 SDL_Surface* loadImage ( string );
+SDL_Surface* convertImage ( SDL_Surface* );
+
+SDL_Rect applySurface ( SDL_Surface*, SDL_Surface*, int, int,
+                        SDL_Rect* = NULL );
 
-void applySurface ( SDL_Surface*, SDL_Surface*, int, int, SDL_Rect* = NULL );
+    bool canBlend ( SDL_Surface*, SDL_Surface* );
+SDL_Rect blendSurface ( SDL_Surface*, SDL_Surface*, int, int,
+                        SDL_Rect* = NULL );
+    void blendRow ( const uint32_t*, uint32_t*, int );
+uint32_t blendPixel ( uint32_t, uint32_t );
 
 void applyText ( string, TTF_Font*, SDL_Surface*, int, int,
                  SDL_Color = {255, 255, 255} );
 
 void wait ( int );
 
+void sleepUntil ( chrono::steady_clock::time_point,
+                  chrono::steady_clock::duration = chrono::microseconds(500) );
+
 CollisionData testCollision ( const Circle&, const Rectangle& );
 
+uint8_t getCollisionFlags ( const Circle&, double, double );
+
+SweepData testSweep ( const Circle&, double, double, const Rectangle& );
+
 //}
 
 //}
@@ -204,8 +734,8 @@ Timer::Timer ( )
 {
 	isStarted_ = false;
 	isPaused_ = false;
-	startTicks_ = 0;
-	pausedTicks_ = 0;
+	startTime_ = 0;
+	pausedTime_ = 0;
 }
 
 //}
@@ -218,7 +748,7 @@ void Timer::start ( )
 	isStarted_ = true;
 	isPaused_ = false;
 	
-	startTicks_ = SDL_GetTicks();
+	startTime_ = now();
 }
 
 
@@ -227,8 +757,8 @@ void Timer::stop ( )
 	isStarted_ = false;
 	isPaused_ = false;
 	
-	startTicks_ = 0;
-	pausedTicks_ = 0;
+	startTime_ = 0;
+	pausedTime_ = 0;
 }
 
 
@@ -237,7 +767,7 @@ void Timer::pause ( )
 	if ( isStarted_ == true and isPaused_ == false ) {
 		isPaused_ = true;
 		
-		pausedTicks_ = SDL_GetTicks() - startTicks_;
+		pausedTime_ = now() - startTime_;
 	}
 }
 
@@ -247,9 +777,9 @@ void Timer::unpause ( )
 	if ( isPaused_ == true ) {
 		isPaused_ = false;
 		
-		startTicks_ = SDL_GetTicks() - pausedTicks_;
+		startTime_ = now() - pausedTime_;
 		
-		pausedTicks_ = 0;
+		pausedTime_ = 0;
 	}
 }
 
@@ -272,13 +802,20 @@ bool Timer::isPaused ( )
 }
 
 
+inline
 int Timer::getTicks ( )
+{
+	return int((*this).getNanoseconds() / 1000000);
+}
+
+
+int64_t Timer::getNanoseconds ( )
 {
 	if ( isStarted_ == true ) {
 		if ( isPaused_ == true )
-			return pausedTicks_;
+			return pausedTime_;
 		else
-			return SDL_GetTicks() - startTicks_;
+			return now() - startTime_;
 	}
 	else
 		return 0;
@@ -286,116 +823,1423 @@ int Timer::getTicks ( )
 
 //}
 
+
+//{ Timer::Static methods
+
+inline
+int64_t Timer::now ( )
+{
+	return chrono::duration_cast<chrono::nanoseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//}
+
 //}
 
 
-//{ Button
+//{ ImageHandle
 
-//{ Button::Constructor and Destructor
+//{ ImageHandle::Constructors and destructor
 
-Button::Button ( string spriteFileName, int initX, int initY, int initWidth,
-                 int initHeight )
+inline
+ImageHandle::ImageHandle ( )
 {
-	positionX_ = initX;
-	positionY_ = initY;
-	height_ = initHeight;
-	width_ = initWidth;
-	
-	isMouseOver_ = false;
-	isPressed_ = false;
-	isClicked_ = false;
-	
-	spriteSheet_ = loadImage(spriteFileName);
+	image_ = NULL;
+}
+
+
+inline
+ImageHandle::ImageHandle ( CachedImage* image )
+{
+	image_ = image;
 	
-	clips_[0] = {0, 0, 200, 50};
-	clips_[1] = {0, 50, 200, 50};
-	clips_[2] = {0, 100, 200, 50};
+	if ( image_ != NULL )
+		image_->references ++;
+}
+
+
+inline
+ImageHandle::ImageHandle ( ImageHandle&& model )
+{
+	image_ = model.image_;
+	model.image_ = NULL;
 }
 
 
 inline
-Button::~Button ( )
+ImageHandle::~ImageHandle ( )
 {
-	SDL_FreeSurface ( spriteSheet_ );
+	(*this).release();
 }
 
 //}
 
 
-//{ Button::Modifying methods
+//{ ImageHandle::Modifying methods
 
-void Button::handleInput ( uint8_t mouseState, int mouseX, int mouseY )
+// Leaves the handle empty.
+void ImageHandle::release ( )
 {
-	isClicked_ = false;
-	
-	if (
-	(mouseX >= positionX_ and mouseX <= positionX_ + width_) and
-	(mouseY >= positionY_ and mouseY <= positionY_ + height_) )
-		isMouseOver_ = true;
-	else
-		isMouseOver_ = false;
+	if ( image_ != NULL )
+		ImageCache::release(image_);
 	
-	if ( (mouseState bitand SDL_BUTTON(1)) and isMouseOver_ )
-		isPressed_ = true;
-	else if ( not (mouseState bitand SDL_BUTTON(1)) and isPressed_ ) {
-		isClicked_ = true;
-		isPressed_ = false;
-	}
-	else
-		isPressed_ = false;
+	image_ = NULL;
 }
 
 //}
 
 
-//{ Button::Non-modifying methods
+//{ ImageHandle::Non-modifying methods
 
 inline
-int Button::getPositionX ( )
+ImageHandle ImageHandle::share ( ) const
+{
+	return ImageHandle(image_);
+}
+
+
+inline
+SDL_Surface* ImageHandle::getSurface ( ) const
+{
+	return image_ != NULL ? image_->surface : NULL;
+}
+
+//}
+
+
+//{ ImageHandle::Modifying operators
+
+ImageHandle& ImageHandle::operator= ( ImageHandle&& model )
+{
+	if ( this != &model ) {
+		(*this).release();
+		
+		image_ = model.image_;
+		model.image_ = NULL;
+	}
+	
+	return *this;
+}
+
+//}
+
+//}
+
+
+//{ ImageLoader
+
+//{ ImageLoader::Static methods
+
+// The surface is NULL if the file can't be decoded. It must be converted or
+// freed by the caller.
+shared_future<SDL_Surface*> ImageLoader::decode ( const string& path )
+{
+	Task task([path] ( ) {
+		return IMG_Load(path.c_str());
+	});
+	shared_future<SDL_Surface*> surface = task.get_future().share();
+	
+	{
+		lock_guard<mutex> guard(lock_);
+		
+		if ( workers_.empty() )
+			for ( int i = 0; i < WORKER_COUNT; i ++ )
+				workers_.emplace_back(&ImageLoader::work);
+		
+		tasks_.push_back(move(task));
+	}
+	isTaskReady_.notify_one();
+	
+	return surface;
+}
+
+
+// Waits for the requests left, then joins the workers. A later request
+// starts them again.
+void ImageLoader::stop ( )
+{
+	{
+		lock_guard<mutex> guard(lock_);
+		isStopping_ = true;
+	}
+	isTaskReady_.notify_all();
+	
+	for ( thread& worker : workers_ )
+		worker.join();
+	
+	workers_.clear();
+	isStopping_ = false;
+}
+
+
+void ImageLoader::work ( )
+{
+	while ( true ) {
+		Task task;
+		{
+			unique_lock<mutex> guard(lock_);
+			isTaskReady_.wait(guard, [] ( ) {
+				return isStopping_ or not tasks_.empty();
+			});
+			
+			if ( tasks_.empty() )
+				return;
+			
+			task = move(tasks_.front());
+			tasks_.pop_front();
+		}
+		
+		task();
+	}
+}
+
+//}
+
+//}
+
+
+//{ ImageCache
+
+//{ ImageCache::Static methods
+
+ImageHandle ImageCache::load ( const string& path )
+{
+	auto cached = images_.find(path);
+	if ( cached != images_.end() ) {
+		CachedImage& image = cached->second;
+		
+		if ( image.references == 0 )
+			unusedImages_.erase(image.unusedPosition);
+		
+		statistics_.hits ++;
+		return ImageHandle(&image);
+	}
+	
+	SDL_Surface* surface = NULL;
+	auto prefetched = prefetched_.find(path);
+	bool isPrefetched = prefetched != prefetched_.end();
+	if ( isPrefetched ) {
+		surface = convertImage(prefetched->second.get());
+		prefetched_.erase(prefetched);
+	}
+	else
+		surface = loadImage(path);
+	
+	if ( surface == NULL )
+		return ImageHandle();
+	
+	if ( isPrefetched )
+		statistics_.prefetches ++;
+	
+	CachedImage& image = images_[path];
+	image.path = path;
+	image.surface = surface;
+	image.size = size_t(surface->pitch) * surface->h;
+	image.references = 0;
+	
+	statistics_.misses ++;
+	statistics_.imageCount ++;
+	statistics_.size += image.size;
+	
+	ImageHandle handle(&image);
+	trim();
+	
+	return handle;
+}
+
+
+// Starts decoding the image on a loader thread, so that its load only waits
+// for what is left of the decoding, then converts it.
+void ImageCache::prefetch ( const string& path )
+{
+	if ( images_.count(path) == 0 and prefetched_.count(path) == 0 )
+		prefetched_[path] = ImageLoader::decode(path);
+}
+
+
+// Images already over the budget are freed as soon as they are unused.
+void ImageCache::setBudget ( size_t budget )
+{
+	statistics_.budget = budget;
+	
+	trim();
+}
+
+
+// Call before SDL_Quit(). The images in use stay valid; the prefetched ones
+// that were never loaded are waited for, then freed.
+void ImageCache::clear ( )
+{
+	for ( auto& prefetched : prefetched_ )
+		SDL_FreeSurface(prefetched.second.get());
+	prefetched_.clear();
+	
+	size_t budget = statistics_.budget;
+	
+	statistics_.budget = 0;
+	trim();
+	
+	statistics_.budget = budget;
+}
+
+
+inline
+ImageCacheStatistics ImageCache::getStatistics ( )
+{
+	return statistics_;
+}
+
+
+void ImageCache::printStatistics ( ostream& destination )
+{
+	int loads = statistics_.hits + statistics_.misses;
+	
+	destination << "Images : " << statistics_.imageCount << " ("
+	            << statistics_.size / 1024 << " / "
+	            << statistics_.budget / 1024 << " KiB), "
+	            << statistics_.misses << " decoded for " << loads
+	            << " loads (" << statistics_.prefetches << " in advance), "
+	            << statistics_.evictions << " evicted\n";
+}
+
+
+// Called by the last handle of an image.
+void ImageCache::release ( CachedImage* image )
+{
+	image->references --;
+	
+	if ( image->references == 0 ) {
+		unusedImages_.push_front(image);
+		image->unusedPosition = unusedImages_.begin();
+		
+		trim();
+	}
+}
+
+
+// Frees the least recently used images until the budget is met, or until
+// only images in use are left.
+void ImageCache::trim ( )
+{
+	while ( statistics_.size > statistics_.budget and
+	        not unusedImages_.empty() ) {
+		CachedImage* image = unusedImages_.back();
+		unusedImages_.pop_back();
+		
+		statistics_.size -= image->size;
+		statistics_.imageCount --;
+		statistics_.evictions ++;
+		
+		SDL_FreeSurface(image->surface);
+		images_.erase(string(image->path));
+	}
+}
+
+//}
+
+//}
+
+
+//{ Widget
+
+//{ Widget::Constructors and destructor
+
+// The surface is made by the first apply, in the format of its destination.
+Widget::Widget ( int positionX, int positionY, int width, int height )
+{
+	positionX_ = positionX;
+	positionY_ = positionY;
+	width_ = width;
+	height_ = height;
+	
+	image_ = NULL;
+	isInvalidated_ = true;
+}
+
+
+Widget::~Widget ( )
+{
+	SDL_FreeSurface(image_);
+}
+
+//}
+
+
+//{ Widget::Modifying methods
+
+// Returns the region of the destination drawn on, after clipping.
+SDL_Rect Widget::apply ( SDL_Surface* destination )
+{
+	if ( image_ == NULL or image_->w != width_ or image_->h != height_ ) {
+		SDL_FreeSurface(image_);
+		
+		const SDL_PixelFormat* format = destination->format;
+		image_ = SDL_CreateRGBSurface(SDL_SWSURFACE, width_, height_,
+		                              format->BitsPerPixel, format->Rmask,
+		                              format->Gmask, format->Bmask, 0);
+		isInvalidated_ = true;
+	}
+	
+	if ( isInvalidated_ ) {
+		(*this).compose(image_);
+		isInvalidated_ = false;
+	}
+	
+	return applySurface(image_, destination, positionX_, positionY_);
+}
+
+
+inline
+void Widget::invalidate ( )
+{
+	isInvalidated_ = true;
+}
+
+//}
+
+
+//{ Widget::Non-modifying methods
+
+inline
+bool Widget::hasChanged ( ) const
+{
+	return isInvalidated_;
+}
+
+
+inline
+SDL_Rect Widget::getRect ( ) const
+{
+	return {Sint16(positionX_), Sint16(positionY_), Uint16(width_),
+	        Uint16(height_)};
+}
+
+//}
+
+//}
+
+
+//{ Button
+
+//{ Button::Constructor
+
+Button::Button ( string spriteFileName, int initX, int initY, int initWidth,
+                 int initHeight )
+{
+	positionX_ = initX;
+	positionY_ = initY;
+	height_ = initHeight;
+	width_ = initWidth;
+	
+	isMouseOver_ = false;
+	isPressed_ = false;
+	isClicked_ = false;
+	
+	spriteSheet_ = ImageCache::load(spriteFileName);
+	
+	clips_[0] = {0, 0, 200, 50};
+	clips_[1] = {0, 50, 200, 50};
+	clips_[2] = {0, 100, 200, 50};
+	
+	appliedClip_ = -1;
+}
+
+//}
+
+
+//{ Button::Modifying methods
+
+void Button::handleInput ( uint8_t mouseState, int mouseX, int mouseY )
+{
+	isClicked_ = false;
+	
+	if (
+	(mouseX >= positionX_ and mouseX <= positionX_ + width_) and
+	(mouseY >= positionY_ and mouseY <= positionY_ + height_) )
+		isMouseOver_ = true;
+	else
+		isMouseOver_ = false;
+	
+	if ( (mouseState bitand SDL_BUTTON(1)) and isMouseOver_ )
+		isPressed_ = true;
+	else if ( not (mouseState bitand SDL_BUTTON(1)) and isPressed_ ) {
+		isClicked_ = true;
+		isPressed_ = false;
+	}
+	else
+		isPressed_ = false;
+}
+
+
+void Button::apply ( SDL_Surface* destination )
+{
+	appliedClip_ = (*this).getClipIndex();
+	
+	applySurface(spriteSheet_.getSurface(), destination, positionX_,
+	             positionY_, &clips_[appliedClip_]);
+}
+
+//}
+
+
+//{ Button::Non-modifying methods
+
+inline
+int Button::getPositionX ( )
 {
 	return positionX_;
 }
 
 
-inline
-int Button::getPositionY ( )
+inline
+int Button::getPositionY ( )
+{
+	return positionY_;
+}
+
+
+inline
+int Button::getHeight ( )
+{
+	return height_;
+}
+
+
+inline
+int Button::getWidth ( )
+{
+	return width_;
+}
+
+
+inline
+bool Button::isClicked ( )
+{
+	return isClicked_;
+}
+
+
+inline
+bool Button::hasChanged ( ) const
+{
+	return (*this).getClipIndex() != appliedClip_;
+}
+
+
+// Pressed, under the mouse or idle.
+inline
+int Button::getClipIndex ( ) const
+{
+	if ( isPressed_ )
+		return 2;
+	else if ( isMouseOver_ )
+		return 1;
+	else
+		return 0;
+}
+
+//}
+
+//}
+
+
+//{ StringInput
+
+//{ StringInput::Constructor
+
+StringInput::StringInput ( SDL_Color initTextColor, SDL_Color initBackColor,
+                           TTF_Font* initDisplayFont, int initPositionX,
+                           int initPositionY, int initWidth ) :
+                           Widget(initPositionX, initPositionY, initWidth, 0)
+{
+	text_ = "";
+	
+	textColor_ = initTextColor;
+	backgroundColor_ = initBackColor;
+	
+	displayFont_ = initDisplayFont;
+	
+	height_ = TTF_FontLineSkip(displayFont_) +
+	          int(ceil(TTF_FontLineSkip(displayFont_) / 5.0));
+	
+	isActive_ = false;
+}
+
+//}
+
+
+//{ StringInput::Modifying methods
+
+inline
+void StringInput::activate ( )
+{
+	isActive_ = true;
+	
+	(*this).invalidate();
+}
+
+
+inline
+void StringInput::deactivate ( )
+{
+	isActive_ = false;
+	text_.clear();
+	
+	(*this).invalidate();
+}
+
+
+void StringInput::handleInput ( SDL_Event input )
+{
+	size_t length = text_.length();
+	
+	if ( isActive_ ) {
+		//TODO: save text input.
+		if ( input.type == SDL_KEYDOWN ) {
+			if ( input.key.keysym.sym == SDLK_BACKSPACE and text_.length() != 0 )
+				text_.pop_back();
+			else if ( 
+			input.key.keysym.unicode >= 0x20 and 
+			input.key.keysym.unicode <= 0x7E )
+				text_ += char(input.key.keysym.unicode);
+		}
+	}
+	
+	if ( text_.length() != length )
+		(*this).invalidate();
+}
+
+
+SDL_Rect StringInput::apply ( SDL_Surface* destination )
+{
+	if ( not isActive_ )
+		return {Sint16(positionX_), Sint16(positionY_), 0, 0};
+	
+	return Widget::apply(destination);
+}
+
+
+// The text is drawn from the glyph atlas of its font, which holds every
+// character that can be typed.
+void StringInput::compose ( SDL_Surface* image )
+{
+	SDL_FillRect(image, NULL, SDL_MapRGB(image->format, backgroundColor_.r,
+	                                     backgroundColor_.g,
+	                                     backgroundColor_.b));
+	
+	int margin = TTF_FontLineSkip(displayFont_) / 5;
+	FontCache::getAtlas(displayFont_, textColor_).apply(text_, image, margin,
+	                                                    margin);
+}
+
+//}
+
+
+//{ StringInput::Non-modifying methods
+
+inline
+bool StringInput::isActive ( )
+{
+	return isActive_;
+}
+
+
+inline
+string StringInput::getText ( )
+{
+	return text_;
+}
+
+
+//}
+
+//}
+
+
+//{ FramePacer
+
+//{ FramePacer::Constructor
+
+FramePacer::FramePacer ( double frameRate, int spinMargin )
+{
+	period_ = chrono::duration_cast<Clock::duration>(
+		chrono::duration<double>(1.0 / frameRate));
+	spinMargin_ = chrono::microseconds(spinMargin);
+	isStarted_ = false;
+	
+	(*this).resetStatistics();
+}
+
+//}
+
+
+//{ FramePacer::Modifying methods
+
+// Starts counting the first frame from now.
+void FramePacer::start ( )
+{
+	frameStart_ = Clock::now();
+	deadline_ = frameStart_;
+	isStarted_ = true;
+}
+
+
+// Waits for the end of the current frame.
+void FramePacer::waitNextFrame ( )
+{
+	if ( not isStarted_ )
+		(*this).start();
+	
+	deadline_ += period_;
+	
+	if ( Clock::now() > deadline_ ) {
+		missedDeadlines_++;
+		deadline_ = Clock::now();
+	}
+	else
+		sleepUntil(deadline_, spinMargin_);
+	
+	Clock::time_point frameEnd = Clock::now();
+	double frameTime = chrono::duration<double, milli>(frameEnd -
+	                                                   frameStart_).count();
+	
+	if ( int(frameTimes_.size()) < SAMPLE_COUNT )
+		frameTimes_.push_back(frameTime);
+	else
+		frameTimes_[frameCount_ % SAMPLE_COUNT] = frameTime;
+	
+	frameCount_++;
+	frameStart_ = frameEnd;
+}
+
+
+void FramePacer::resetStatistics ( )
+{
+	frameTimes_.clear();
+	frameTimes_.reserve(SAMPLE_COUNT);
+	frameCount_ = 0;
+	missedDeadlines_ = 0;
+}
+
+//}
+
+
+//{ FramePacer::Non-modifying methods
+
+// Over the latest SAMPLE_COUNT frames.
+double FramePacer::getAverageFrameTime ( ) const
+{
+	if ( frameTimes_.empty() )
+		return 0.0;
+	
+	double sum = 0.0;
+	for ( double frameTime : frameTimes_ )
+		sum += frameTime;
+	
+	return sum / frameTimes_.size();
+}
+
+
+// Over the latest SAMPLE_COUNT frames, e.g. 99.0 for the 99th percentile.
+double FramePacer::getFrameTimePercentile ( double percentile ) const
+{
+	if ( frameTimes_.empty() )
+		return 0.0;
+	
+	vector<double> sorted(frameTimes_);
+	
+	int rank = int(ceil(percentile / 100.0 * sorted.size())) - 1;
+	rank = max(0, min(rank, int(sorted.size()) - 1));
+	
+	nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	
+	return sorted[rank];
+}
+
+
+inline
+int FramePacer::getMissedDeadlines ( ) const
+{
+	return missedDeadlines_;
+}
+
+
+inline
+int FramePacer::getFrameCount ( ) const
+{
+	return frameCount_;
+}
+
+//}
+
+//}
+
+
+//{ GlyphAtlas
+
+//{ GlyphAtlas::Constructor and destructor
+
+// Every glyph is rendered alone with TTF_RenderText_Solid, so that it keeps
+// its place relative to the baseline, then copied in a cell of the atlas.
+GlyphAtlas::GlyphAtlas ( TTF_Font* font, SDL_Color color )
+{
+	SDL_Surface* glyphs[GLYPH_COUNT];
+	int cellWidth = 1;
+	int cellHeight = 1;
+	
+	char glyphText[2] = {'\0', '\0'};
+	for ( int i = 0; i < GLYPH_COUNT; i ++ ) {
+		glyphText[0] = char(getCharacter(i));
+		glyphs[i] = TTF_RenderText_Solid(font, glyphText, color);
+		
+		int minX, maxX, minY, maxY;
+		if ( TTF_GlyphMetrics(font, Uint16(getCharacter(i)), &minX, &maxX,
+		                      &minY, &maxY, &advances_[i]) != 0 )
+			advances_[i] = glyphs[i] != NULL ? glyphs[i]->w : 0;
+		
+		if ( glyphs[i] != NULL ) {
+			cellWidth = max(cellWidth, glyphs[i]->w);
+			cellHeight = max(cellHeight, glyphs[i]->h);
+		}
+	}
+	height_ = TTF_FontHeight(font);
+	
+	int rowCount = (GLYPH_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+	SDL_Surface* atlas = SDL_CreateRGBSurface(SDL_SWSURFACE,
+	                                          ATLAS_COLUMNS * cellWidth,
+	                                          rowCount * cellHeight,
+	                                          32, 0, 0, 0, 0);
+	surface_ = SDL_DisplayFormat(atlas);
+	SDL_FreeSurface(atlas);
+	
+	// Solid glyphs have a single color, so its inverse can't be in them.
+	Uint32 colorKey = SDL_MapRGB(surface_->format, 255 - color.r,
+	                             255 - color.g, 255 - color.b);
+	SDL_FillRect(surface_, NULL, colorKey);
+	
+	for ( int i = 0; i < GLYPH_COUNT; i ++ ) {
+		SDL_Rect& glyphRect = glyphRects_[i];
+		glyphRect.x = Sint16(i % ATLAS_COLUMNS * cellWidth);
+		glyphRect.y = Sint16(i / ATLAS_COLUMNS * cellHeight);
+		glyphRect.w = 0;
+		glyphRect.h = 0;
+		
+		if ( glyphs[i] != NULL ) {
+			glyphRect.w = Uint16(glyphs[i]->w);
+			glyphRect.h = Uint16(glyphs[i]->h);
+			
+			applySurface(glyphs[i], surface_, glyphRect.x, glyphRect.y);
+			SDL_FreeSurface(glyphs[i]);
+		}
+	}
+	
+	SDL_SetColorKey(surface_, SDL_SRCCOLORKEY | SDL_RLEACCEL, colorKey);
+}
+
+
+GlyphAtlas::~GlyphAtlas ( )
+{
+	SDL_FreeSurface(surface_);
+}
+
+//}
+
+
+//{ GlyphAtlas::Static methods
+
+// Index of a character in the atlas. The C0 controls, DEL and the C1
+// controls (127 to 159) have no glyph.
+inline
+int GlyphAtlas::getGlyphIndex ( unsigned char character )
+{
+	if ( character >= 160 )
+		return ASCII_GLYPH_COUNT + character - 160;
+	if ( character >= 32 and character < 127 )
+		return character - 32;
+	
+	return -1;
+}
+
+
+inline
+unsigned char GlyphAtlas::getCharacter ( int glyph )
+{
+	return glyph < ASCII_GLYPH_COUNT ? 32 + glyph :
+	                                   160 + glyph - ASCII_GLYPH_COUNT;
+}
+
+//}
+
+
+//{ GlyphAtlas::Non-modifying methods
+
+int GlyphAtlas::apply ( string_view text, SDL_Surface* destination,
+                        int offsetX, int offsetY ) const
+{
+	for ( unsigned char character : text ) {
+		int glyph = getGlyphIndex(character);
+		if ( glyph < 0 )
+			continue;
+		
+		SDL_Rect clip = glyphRects_[glyph];
+		SDL_Rect offsetPosition = {Sint16(offsetX), Sint16(offsetY), 0, 0};
+		SDL_BlitSurface(surface_, &clip, destination, &offsetPosition);
+		
+		offsetX += advances_[glyph];
+	}
+	
+	return offsetX;
+}
+
+
+int GlyphAtlas::getTextWidth ( string_view text ) const
+{
+	int width = 0;
+	for ( unsigned char character : text ) {
+		int glyph = getGlyphIndex(character);
+		if ( glyph >= 0 )
+			width += advances_[glyph];
+	}
+	
+	return width;
+}
+
+
+inline
+int GlyphAtlas::getHeight ( ) const
+{
+	return height_;
+}
+
+//}
+
+//}
+
+
+//{ FontCache
+
+TTF_Font* FontCache::getFont ( const string& filename, int size )
+{
+	pair<string, int> key(filename, size);
+	
+	auto font = fonts_.find(key);
+	if ( font != fonts_.end() )
+		return font->second;
+	
+	TTF_Font* openedFont = TTF_OpenFont(filename.c_str(), size);
+	if ( openedFont != NULL )
+		fonts_[key] = openedFont;
+	
+	return openedFont;
+}
+
+
+// The font must come from getFont(). Its atlas for the color is built the
+// first time it is asked for.
+GlyphAtlas& FontCache::getAtlas ( TTF_Font* font, SDL_Color color )
+{
+	uint32_t packedColor = uint32_t(color.r) << 16 | uint32_t(color.g) << 8 |
+	                       uint32_t(color.b);
+	pair<TTF_Font*, uint32_t> key(font, packedColor);
+	
+	auto atlas = atlases_.find(key);
+	if ( atlas != atlases_.end() )
+		return *atlas->second;
+	
+	GlyphAtlas* newAtlas = new GlyphAtlas(font, color);
+	atlases_[key] = newAtlas;
+	
+	return *newAtlas;
+}
+
+
+// Frees every atlas and closes every font, e.g. before TTF_Quit().
+void FontCache::clear ( )
+{
+	for ( auto& atlas : atlases_ )
+		delete atlas.second;
+	atlases_.clear();
+	
+	for ( auto& font : fonts_ )
+		TTF_CloseFont(font.second);
+	fonts_.clear();
+}
+
+//}
+
+
+
+
+//{ RectangleBatch
+
+//{ RectangleBatch::Constructor
+
+inline
+RectangleBatch::RectangleBatch ( )
+{
+	isGridBuilt_ = false;
+}
+
+//}
+
+
+//{ RectangleBatch::Modifying methods
+
+void RectangleBatch::add ( const Rectangle& rectangle )
+{
+	left_.push_back(0.0);
+	right_.push_back(0.0);
+	top_.push_back(0.0);
+	bottom_.push_back(0.0);
+	
+	(*this).set(int(left_.size()) - 1, rectangle);
+}
+
+
+void RectangleBatch::set ( int index, const Rectangle& rectangle )
+{
+	left_[index] = rectangle.positionX - rectangle.width / 2;
+	right_[index] = rectangle.positionX + rectangle.width / 2;
+	top_[index] = rectangle.positionY - rectangle.height / 2;
+	bottom_[index] = rectangle.positionY + rectangle.height / 2;
+	
+	isGridBuilt_ = false;
+}
+
+
+void RectangleBatch::clear ( )
+{
+	left_.clear();
+	right_.clear();
+	top_.clear();
+	bottom_.clear();
+	
+	isGridBuilt_ = false;
+}
+
+//}
+
+
+//{ RectangleBatch::Non-modifying methods
+
+inline
+int RectangleBatch::getSize ( ) const
+{
+	return int(left_.size());
+}
+
+
+Rectangle RectangleBatch::getRectangle ( int index ) const
+{
+	return {(left_[index] + right_[index]) / 2,
+	        (top_[index] + bottom_[index]) / 2,
+	        right_[index] - left_[index],
+	        bottom_[index] - top_[index]};
+}
+
+
+inline
+void RectangleBatch::testCollisions ( const Circle& circle,
+                                      vector<CollisionHit>& hits ) const
+{
+	(*this).testCollisions(&circle, 1, hits);
+}
+
+
+// Appends a hit for every rectangle colliding with a circle, by order of
+// circle then rectangle, with the same results as testCollision(). A
+// colliding rectangle overlaps the square around the circle, so it is in one
+// of the cells under that square; it is found once in each of them.
+void RectangleBatch::testCollisions ( const Circle* circles, int circleCount,
+                                      vector<CollisionHit>& hits ) const
+{
+	if ( not isGridBuilt_ )
+		(*this).buildGrid();
+	
+	for ( int c = 0; c < circleCount; c ++ ) {
+		const Circle& circle = circles[c];
+		
+		if ( grid_.columns == 0 ) {
+			Span batch = {left_.data(), right_.data(), top_.data(),
+			              bottom_.data(), NULL, (*this).getSize()};
+			(*this).testSpan(circle, c, batch, hits);
+			continue;
+		}
+		
+		// The square is grown a little, against the rounding of its sides.
+		double reach = circle.radius * (1.0 + 1e-9);
+		int firstColumn = (*this).getCell(circle.positionX - reach,
+		                                  grid_.originX, grid_.columns);
+		int lastColumn = (*this).getCell(circle.positionX + reach,
+		                                 grid_.originX, grid_.columns);
+		int firstRow = (*this).getCell(circle.positionY - reach,
+		                               grid_.originY, grid_.rows);
+		int lastRow = (*this).getCell(circle.positionY + reach,
+		                              grid_.originY, grid_.rows);
+		
+		firstColumn = max(firstColumn, 0);
+		lastColumn = min(lastColumn, grid_.columns - 1);
+		firstRow = max(firstRow, 0);
+		lastRow = min(lastRow, grid_.rows - 1);
+		
+		size_t firstHit = hits.size();
+		
+		for ( int row = firstRow; row <= lastRow; row ++ )
+			for ( int column = firstColumn; column <= lastColumn; column ++ ) {
+				int cell = row * grid_.columns + column;
+				int start = grid_.cellStarts[cell];
+				
+				Span span = {&grid_.left[start], &grid_.right[start],
+				             &grid_.top[start], &grid_.bottom[start],
+				             &grid_.indices[start],
+				             grid_.cellStarts[cell + 1] - start};
+				(*this).testSpan(circle, c, span, hits);
+			}
+		
+		// A rectangle over several of the cells is found in each of them.
+		if ( firstColumn < lastColumn or firstRow < lastRow ) {
+			auto byRectangle = [] ( const CollisionHit& first,
+			                        const CollisionHit& second ) {
+				return first.rectangleIndex < second.rectangleIndex;
+			};
+			auto isSameRectangle = [] ( const CollisionHit& first,
+			                            const CollisionHit& second ) {
+				return first.rectangleIndex == second.rectangleIndex;
+			};
+			
+			sort(hits.begin() + firstHit, hits.end(), byRectangle);
+			hits.erase(unique(hits.begin() + firstHit, hits.end(),
+			                  isSameRectangle), hits.end());
+		}
+	}
+}
+
+
+// The cells are about as many as the rectangles over GRID_CELL_LOAD, over
+// the area the rectangles span, and not narrower than an average rectangle.
+// Batches whose rectangles would cover too many cells are scanned instead.
+void RectangleBatch::buildGrid ( ) const
+{
+	int size = (*this).getSize();
+	
+	isGridBuilt_ = true;
+	grid_.columns = 0;
+	grid_.rows = 0;
+	
+	if ( not isGridEnabled or size < GRID_MIN_SIZE )
+		return;
+	
+	double minX = *min_element(left_.begin(), left_.end());
+	double maxX = *max_element(right_.begin(), right_.end());
+	double minY = *min_element(top_.begin(), top_.end());
+	double maxY = *max_element(bottom_.begin(), bottom_.end());
+	
+	double meanSide = 0.0;
+	for ( int i = 0; i < size; i ++ )
+		meanSide += (right_[i] - left_[i]) + (bottom_[i] - top_[i]);
+	meanSide /= 2 * size;
+	
+	double cellSize = max(sqrt((maxX - minX) * (maxY - minY) *
+	                           GRID_CELL_LOAD / size), meanSide);
+	if ( not ( cellSize > 0.0 and isfinite(cellSize) ) )
+		return;
+	
+	// Lone rectangles far from the others make a sparse grid.
+	while ( ((maxX - minX) / cellSize + 1) * ((maxY - minY) / cellSize + 1) >
+	        4.0 * size )
+		cellSize *= 2;
+	
+	grid_.originX = minX;
+	grid_.originY = minY;
+	grid_.cellSize = cellSize;
+	grid_.columns = int((maxX - minX) / cellSize) + 1;
+	grid_.rows = int((maxY - minY) / cellSize) + 1;
+	
+	vector<int>& starts = grid_.cellStarts;
+	starts.assign(size_t(grid_.columns) * grid_.rows + 1, 0);
+	
+	long entryCount = 0;
+	for ( int pass = 0; pass < 2; pass ++ ) {
+		for ( int i = 0; i < size; i ++ ) {
+			int firstColumn = (*this).getCell(left_[i], minX, grid_.columns);
+			int lastColumn = (*this).getCell(right_[i], minX, grid_.columns);
+			int firstRow = (*this).getCell(top_[i], minY, grid_.rows);
+			int lastRow = (*this).getCell(bottom_[i], minY, grid_.rows);
+			
+			for ( int row = firstRow; row <= lastRow; row ++ )
+				for ( int column = firstColumn; column <= lastColumn;
+				      column ++ ) {
+					int cell = row * grid_.columns + column;
+					
+					if ( pass == 0 ) {
+						starts[cell + 1] ++;
+						entryCount ++;
+					}
+					else {
+						int entry = starts[cell] ++;
+						grid_.left[entry] = left_[i];
+						grid_.right[entry] = right_[i];
+						grid_.top[entry] = top_[i];
+						grid_.bottom[entry] = bottom_[i];
+						grid_.indices[entry] = i;
+					}
+				}
+		}
+		
+		if ( pass == 0 ) {
+			if ( entryCount > 8L * size ) {
+				grid_.columns = 0;
+				grid_.rows = 0;
+				return;
+			}
+			
+			for ( size_t cell = 1; cell < starts.size(); cell ++ )
+				starts[cell] += starts[cell - 1];
+			
+			grid_.left.resize(entryCount);
+			grid_.right.resize(entryCount);
+			grid_.top.resize(entryCount);
+			grid_.bottom.resize(entryCount);
+			grid_.indices.resize(entryCount);
+		}
+	}
+	
+	// The second pass moved every start to the end of its cell.
+	for ( size_t cell = starts.size() - 1; cell > 0; cell -- )
+		starts[cell] = starts[cell - 1];
+	starts[0] = 0;
+}
+
+
+// Column or row of a coordinate. -1 and count stand for before and after the
+// grid.
+inline
+int RectangleBatch::getCell ( double coordinate, double origin,
+                              int count ) const
+{
+	double cell = floor((coordinate - origin) / grid_.cellSize);
+	
+	return int(max(-1.0, min(cell, double(count))));
+}
+
+
+// Every group of lanes is reduced to a mask of its hits, which are rare, and
+// only those are looked at again.
+void RectangleBatch::testSpan ( const Circle& circle, int circleIndex,
+                                const Span& span,
+                                vector<CollisionHit>& hits ) const
+{
+	double squaredRadius = circle.radius * circle.radius;
+	
+	int i = 0;
+	
+#if defined(GALLICA_COLLISION_AVX)
+	__m256d x = _mm256_set1_pd(circle.positionX);
+	__m256d y = _mm256_set1_pd(circle.positionY);
+	__m256d radius = _mm256_set1_pd(squaredRadius);
+	
+	for ( ; i + 4 <= span.size; i += 4 ) {
+		__m256d closestX = _mm256_min_pd(_mm256_max_pd(x,
+		                   _mm256_loadu_pd(&span.left[i])),
+		                   _mm256_loadu_pd(&span.right[i]));
+		__m256d closestY = _mm256_min_pd(_mm256_max_pd(y,
+		                   _mm256_loadu_pd(&span.top[i])),
+		                   _mm256_loadu_pd(&span.bottom[i]));
+		__m256d distanceX = _mm256_sub_pd(x, closestX);
+		__m256d distanceY = _mm256_sub_pd(y, closestY);
+		__m256d distance = _mm256_add_pd(
+		                   _mm256_mul_pd(distanceX, distanceX),
+		                   _mm256_mul_pd(distanceY, distanceY));
+		
+		int mask = _mm256_movemask_pd(_mm256_cmp_pd(distance, radius,
+		                                            _CMP_LT_OQ));
+		if ( mask != 0 )
+			(*this).addHits(circle, circleIndex, span, i, mask, hits);
+	}
+#elif defined(GALLICA_COLLISION_SSE2)
+	__m128d x = _mm_set1_pd(circle.positionX);
+	__m128d y = _mm_set1_pd(circle.positionY);
+	__m128d radius = _mm_set1_pd(squaredRadius);
+	
+	for ( ; i + 2 <= span.size; i += 2 ) {
+		__m128d closestX = _mm_min_pd(_mm_max_pd(x,
+		                   _mm_loadu_pd(&span.left[i])),
+		                   _mm_loadu_pd(&span.right[i]));
+		__m128d closestY = _mm_min_pd(_mm_max_pd(y,
+		                   _mm_loadu_pd(&span.top[i])),
+		                   _mm_loadu_pd(&span.bottom[i]));
+		__m128d distanceX = _mm_sub_pd(x, closestX);
+		__m128d distanceY = _mm_sub_pd(y, closestY);
+		__m128d distance = _mm_add_pd(_mm_mul_pd(distanceX, distanceX),
+		                              _mm_mul_pd(distanceY, distanceY));
+		
+		int mask = _mm_movemask_pd(_mm_cmplt_pd(distance, radius));
+		if ( mask != 0 )
+			(*this).addHits(circle, circleIndex, span, i, mask, hits);
+	}
+#endif
+	
+	for ( ; i < span.size; i ++ ) {
+		double closestX = min(max(circle.positionX, span.left[i]),
+		                      span.right[i]);
+		double closestY = min(max(circle.positionY, span.top[i]),
+		                      span.bottom[i]);
+		double distanceX = circle.positionX - closestX;
+		double distanceY = circle.positionY - closestY;
+		
+		if ( distanceX * distanceX + distanceY * distanceY < squaredRadius )
+			(*this).addHits(circle, circleIndex, span, i, 1, hits);
+	}
+}
+
+
+// Appends the hits of the lanes set in a mask, the first lane being the
+// rectangle at an offset in the span.
+void RectangleBatch::addHits ( const Circle& circle, int circleIndex,
+                               const Span& span, int offset, int mask,
+                               vector<CollisionHit>& hits ) const
+{
+	for ( ; mask != 0; mask >>= 1, offset ++ )
+		if ( mask & 1 ) {
+			double closestX = min(max(circle.positionX, span.left[offset]),
+			                      span.right[offset]);
+			double closestY = min(max(circle.positionY, span.top[offset]),
+			                      span.bottom[offset]);
+			int index = span.indices != NULL ? span.indices[offset] : offset;
+			
+			hits.push_back({circleIndex, index, {closestX, closestY,
+			                getCollisionFlags(circle, closestX, closestY)}});
+		}
+}
+
+//}
+
+//}
+
+
+
+
+//{ DirtyRegions
+
+//{ DirtyRegions::Constructor
+
+// Starts invalidated, the screen having never been sent.
+DirtyRegions::DirtyRegions ( int width, int height )
+{
+	width_ = width;
+	height_ = height;
+	isInvalidated_ = true;
+	updatedArea_ = 0;
+}
+
+//}
+
+
+//{ DirtyRegions::Modifying methods
+
+// The region is clipped to the screen.
+void DirtyRegions::add ( SDL_Rect region )
 {
-	return positionY_;
+	if ( isInvalidated_ )
+		return;
+	
+	int left = max(0, int(region.x));
+	int top = max(0, int(region.y));
+	int right = min(width_, region.x + region.w);
+	int bottom = min(height_, region.y + region.h);
+	
+	if ( left < right and top < bottom )
+		regions_.push_back({Sint16(left), Sint16(top), Uint16(right - left),
+		                    Uint16(bottom - top)});
 }
 
 
 inline
-int Button::getHeight ( )
+void DirtyRegions::invalidate ( )
 {
-	return height_;
+	isInvalidated_ = true;
+	regions_.clear();
 }
 
 
-inline
-int Button::getWidth ( )
+// Partial updates need a single buffered screen; a double buffered one is
+// always flipped whole.
+void DirtyRegions::update ( SDL_Surface* screen )
 {
-	return width_;
+	(*this).merge();
+	
+	int area = 0;
+	for ( const SDL_Rect& region : regions_ )
+		area += region.w * region.h;
+	
+	if ( area > FULL_UPDATE_RATIO * width_ * height_ or
+	     screen->flags & SDL_DOUBLEBUF )
+		isInvalidated_ = true;
+	
+	if ( isInvalidated_ ) {
+		SDL_Flip(screen);
+		updatedArea_ = width_ * height_;
+	}
+	else {
+		if ( not regions_.empty() )
+			SDL_UpdateRects(screen, int(regions_.size()), &regions_[0]);
+		updatedArea_ = area;
+	}
+	
+	isInvalidated_ = false;
+	regions_.clear();
+}
+
+
+// Replaces every pair of overlapping or touching regions by their bounding
+// box, until no pair is left.
+void DirtyRegions::merge ( )
+{
+	bool isMerged = true;
+	while ( isMerged ) {
+		isMerged = false;
+		
+		for ( int i = 0; i < int(regions_.size()); i ++ )
+			for ( int j = int(regions_.size()) - 1; j > i; j -- ) {
+				SDL_Rect& first = regions_[i];
+				const SDL_Rect& second = regions_[j];
+				
+				if ( first.x <= second.x + second.w and
+				     second.x <= first.x + first.w and
+				     first.y <= second.y + second.h and
+				     second.y <= first.y + first.h ) {
+					int right = max(first.x + first.w, second.x + second.w);
+					int bottom = max(first.y + first.h, second.y + second.h);
+					
+					first.x = min(first.x, second.x);
+					first.y = min(first.y, second.y);
+					first.w = Uint16(right - first.x);
+					first.h = Uint16(bottom - first.y);
+					
+					regions_.erase(regions_.begin() + j);
+					isMerged = true;
+				}
+			}
+	}
 }
 
+//}
+
+
+//{ DirtyRegions::Non-modifying methods
 
 inline
-bool Button::isClicked ( )
+bool DirtyRegions::isInvalidated ( ) const
 {
-	return isClicked_;
+	return isInvalidated_;
 }
 
 
-void Button::apply ( SDL_Surface* destination )
+inline
+int DirtyRegions::getUpdatedArea ( ) const
 {
-	if ( isPressed_ )
-	applySurface(spriteSheet_, destination, positionX_, positionY_, 
-	             &clips_[2]);
-	else if ( isMouseOver_ )
-	applySurface(spriteSheet_, destination, positionX_, positionY_, 
-	             &clips_[1]);
-	else
-	applySurface(spriteSheet_, destination, positionX_, positionY_, 
-	             &clips_[0]);
+	return updatedArea_;
 }
 
 //}
@@ -403,98 +2247,256 @@ void Button::apply ( SDL_Surface* destination )
 //}
 
 
-//{ StringInput
 
-//{ StringInput::Constructor
 
-StringInput::StringInput ( SDL_Color initTextColor, SDL_Color initBackColor,
-                           TTF_Font* initDisplayFont, int initPositionX,
-                           int initPositionY, int initWidth )
+//{ RenderQueue
+
+//{ RenderQueue::Constructor
+
+// The viewport starts at the origin of the world.
+RenderQueue::RenderQueue ( int width, int height )
 {
-	text_ = "";
+	viewportX_ = 0;
+	viewportY_ = 0;
+	width_ = width;
+	height_ = height;
+	drawnCount_ = 0;
+	culledCount_ = 0;
+}
+
+//}
+
+
+//{ RenderQueue::Modifying methods
+
+inline
+void RenderQueue::setViewport ( int x, int y )
+{
+	viewportX_ = x;
+	viewportY_ = y;
+}
+
+
+// Without a clip, the whole source is drawn.
+void RenderQueue::submit ( SDL_Surface* source, int x, int y,
+                           const SDL_Rect* clip, int layer )
+{
+	if ( source == NULL )
+		return;
 	
-	textColor_ = initTextColor;
-	backgroundColor_ = initBackColor;
+	RenderCommand command;
+	command.source = source;
+	command.clip = clip != NULL ? *clip :
+	               SDL_Rect{0, 0, Uint16(source->w), Uint16(source->h)};
+	command.x = x;
+	command.y = y;
+	command.layer = layer;
 	
-	displayFont_ = initDisplayFont;
+	commands_.push_back(command);
+}
+
+
+// The destination is clipped to the viewport while drawing. The sort is
+// stable, so that sprites of the same layer overlap as they were submitted.
+void RenderQueue::execute ( SDL_Surface* destination )
+{
+	int size = int(commands_.size());
 	
-	positionX_ = initPositionX;
-	positionY_ = initPositionY;
-	width_ = initWidth;
-	height_ = TTF_FontLineSkip(displayFont_) +
-	          int(ceil(TTF_FontLineSkip(displayFont_) / 5.0));
+	int right = viewportX_ + width_;
+	int bottom = viewportY_ + height_;
+	commands_.erase(remove_if(commands_.begin(), commands_.end(),
+		[&] ( const RenderCommand& command ) {
+			return command.x >= right or command.y >= bottom or
+			       command.x + command.clip.w <= viewportX_ or
+			       command.y + command.clip.h <= viewportY_;
+		}), commands_.end());
 	
-	isActive_ = false;
+	stable_sort(commands_.begin(), commands_.end(),
+		[] ( const RenderCommand& first, const RenderCommand& second ) {
+			return first.layer < second.layer;
+		});
+	
+	SDL_Rect previousBounds;
+	SDL_GetClipRect(destination, &previousBounds);
+	SDL_Rect bounds = {0, 0, Uint16(width_), Uint16(height_)};
+	SDL_SetClipRect(destination, &bounds);
+	
+	for ( RenderCommand& command : commands_ )
+		applySurface(command.source, destination, command.x - viewportX_,
+		             command.y - viewportY_, &command.clip);
+	
+	SDL_SetClipRect(destination, &previousBounds);
+	
+	drawnCount_ = int(commands_.size());
+	culledCount_ = size - drawnCount_;
+	commands_.clear();
+}
+
+
+inline
+void RenderQueue::clear ( )
+{
+	commands_.clear();
 }
 
 //}
 
 
-//{ StringInput::Modifying methods
+//{ RenderQueue::Non-modifying methods
 
 inline
-void StringInput::activate ( )
+int RenderQueue::getSize ( ) const
 {
-	isActive_ = true;
+	return int(commands_.size());
 }
 
 
 inline
-void StringInput::deactivate ( )
+int RenderQueue::getDrawnCount ( ) const
 {
-	isActive_ = false;
-	text_.clear();
+	return drawnCount_;
 }
 
 
-void StringInput::handleInput ( SDL_Event input )
+inline
+int RenderQueue::getCulledCount ( ) const
 {
-	if ( isActive_ ) {
-		//TODO: save text input.
-		if ( input.type == SDL_KEYDOWN ) {
-			if ( input.key.keysym.sym == SDLK_BACKSPACE and text_.length() != 0 )
-				text_.pop_back();
-			else if ( 
-			input.key.keysym.unicode >= 0x20 and 
-			input.key.keysym.unicode <= 0x7E )
-				text_ += char(input.key.keysym.unicode);
-		}
-	}
+	return culledCount_;
 }
 
 //}
 
+//}
+
 
-//{ StringInput::Non-modifying methods
 
-inline
-bool StringInput::isActive ( )
+
+//{ EventPump
+
+//{ EventPump::Constructor
+
+EventPump::EventPump ( )
 {
-	return isActive_;
+	(*this).resetStatistics();
 }
 
+//}
 
-inline
-string StringInput::getText ( )
+
+//{ EventPump::Modifying methods
+
+// The events returned stay valid until the next pump.
+const vector<SDL_Event>& EventPump::pump ( )
 {
-	return text_;
+	events_.clear();
+	
+	Clock::time_point pumpTime = Clock::now();
+	
+	SDL_Event event;
+	while ( SDL_PollEvent(&event) ) {
+		events_.push_back(event);
+		
+		if ( isInput(event) )
+			pendingInputs_.push_back(pumpTime);
+	}
+	
+	return events_;
 }
 
 
-void StringInput::apply ( SDL_Surface* destination )
+// Every input pumped since the last call has reached the screen.
+void EventPump::markPresented ( )
 {
-	if ( isActive_ == true ) {
-		SDL_Rect zone = {positionX_, positionY_, width_, height_};
-		Uint32 formattedBackColor = SDL_MapRGB(destination->format,
-		                                       backgroundColor_.r,
-		                                       backgroundColor_.g,
-		                                       backgroundColor_.b);
+	Clock::time_point presentTime = Clock::now();
+	
+	for ( Clock::time_point pumpTime : pendingInputs_ ) {
+		double latency = chrono::duration<double, milli>(presentTime -
+		                                                 pumpTime).count();
 		
-		SDL_FillRect(destination, &zone, formattedBackColor);
-		applyText(text_, displayFont_, destination, 
-		          positionX_ + TTF_FontLineSkip(displayFont_) / 5,
-		          positionY_ + TTF_FontLineSkip(displayFont_) / 5, textColor_);
+		if ( int(latencies_.size()) < SAMPLE_COUNT )
+			latencies_.push_back(latency);
+		else
+			latencies_[inputCount_ % SAMPLE_COUNT] = latency;
+		
+		inputCount_++;
 	}
+	
+	pendingInputs_.clear();
+}
+
+
+void EventPump::resetStatistics ( )
+{
+	pendingInputs_.clear();
+	latencies_.clear();
+	latencies_.reserve(SAMPLE_COUNT);
+	inputCount_ = 0;
+}
+
+//}
+
+
+//{ EventPump::Non-modifying methods
+
+// Over the latest SAMPLE_COUNT inputs.
+double EventPump::getAverageLatency ( ) const
+{
+	if ( latencies_.empty() )
+		return 0.0;
+	
+	double sum = 0.0;
+	for ( double latency : latencies_ )
+		sum += latency;
+	
+	return sum / latencies_.size();
+}
+
+
+// Over the latest SAMPLE_COUNT inputs, e.g. 99.0 for the 99th percentile.
+double EventPump::getLatencyPercentile ( double percentile ) const
+{
+	if ( latencies_.empty() )
+		return 0.0;
+	
+	vector<double> sorted(latencies_);
+	
+	int rank = int(ceil(percentile / 100.0 * sorted.size())) - 1;
+	rank = max(0, min(rank, int(sorted.size()) - 1));
+	
+	nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	
+	return sorted[rank];
+}
+
+
+inline
+int EventPump::getInputCount ( ) const
+{
+	return inputCount_;
+}
+
+
+void EventPump::printStatistics ( ostream& destination ) const
+{
+	destination << "Input latency : " << inputCount_ << " inputs, mean "
+	            << getAverageLatency() << " ms, p50 "
+	            << getLatencyPercentile(50.0) << " ms, p99 "
+	            << getLatencyPercentile(99.0) << " ms, max "
+	            << getLatencyPercentile(100.0) << " ms\n";
+}
+
+//}
+
+
+//{ EventPump::Static methods
+
+inline
+bool EventPump::isInput ( const SDL_Event& event )
+{
+	return event.type == SDL_KEYDOWN or event.type == SDL_KEYUP or
+	       event.type == SDL_MOUSEMOTION or
+	       event.type == SDL_MOUSEBUTTONDOWN or
+	       event.type == SDL_MOUSEBUTTONUP;
 }
 
 //}
@@ -506,9 +2508,20 @@ void StringInput::apply ( SDL_Surface* destination )
 
 //{ Functions
 
+// Returns NULL if the file can't be loaded.
+inline
 SDL_Surface* loadImage ( string filename )
 {
-	SDL_Surface* loadedImage = IMG_Load(filename.c_str());
+	return convertImage(IMG_Load(filename.c_str()));
+}
+
+
+// Converts a decoded image to the display format, then frees it. Returns
+// NULL for a NULL image.
+SDL_Surface* convertImage ( SDL_Surface* loadedImage )
+{
+	if ( loadedImage == NULL )
+		return NULL;
 	
 	SDL_Surface* optimisedImage = SDL_DisplayFormatAlpha(loadedImage);
 	
@@ -518,12 +2531,201 @@ SDL_Surface* loadImage ( string filename )
 }
 
 
-void applySurface ( SDL_Surface* source, SDL_Surface* destination, int offsetX,
-                    int offsetY, SDL_Rect* clip )
+// Returns the region of the destination drawn on, after clipping.
+SDL_Rect applySurface ( SDL_Surface* source, SDL_Surface* destination,
+                        int offsetX, int offsetY, SDL_Rect* clip )
 {
-	SDL_Rect offsetPosition = {offsetX, offsetY};
+	if ( isBlendingEnabled and canBlend(source, destination) )
+		return blendSurface(source, destination, offsetX, offsetY, clip);
+	
+	SDL_Rect offsetPosition = {Sint16(offsetX), Sint16(offsetY), 0, 0};
 	
 	SDL_BlitSurface(source, clip, destination, &offsetPosition);
+	
+	return offsetPosition;
+}
+
+
+// Whether blendSurface gives the same result as SDL_BlitSurface : a source
+// with an alpha channel, as made by SDL_DisplayFormatAlpha, and a 32 bit
+// destination without one, both with their channels in the same places.
+bool canBlend ( SDL_Surface* source, SDL_Surface* destination )
+{
+	if ( source == NULL or destination == NULL )
+		return false;
+	
+	const SDL_PixelFormat* from = source->format;
+	const SDL_PixelFormat* to = destination->format;
+	
+	return from->BitsPerPixel == 32 and to->BitsPerPixel == 32 and
+	       source->flags & SDL_SRCALPHA and
+	       not (source->flags & SDL_SRCCOLORKEY) and
+	       from->alpha == SDL_ALPHA_OPAQUE and
+	       from->Amask == 0xFF000000 and to->Amask == 0 and
+	       from->Rmask == 0x00FF0000 and to->Rmask == 0x00FF0000 and
+	       from->Gmask == 0x0000FF00 and to->Gmask == 0x0000FF00 and
+	       from->Bmask == 0x000000FF and to->Bmask == 0x000000FF;
+}
+
+
+// Blits with per pixel alpha like SDL_BlitSurface, with the same clipping
+// and to the same bits, as checked by canBlend().
+SDL_Rect blendSurface ( SDL_Surface* source, SDL_Surface* destination,
+                        int offsetX, int offsetY, SDL_Rect* clip )
+{
+	int sourceX = 0;
+	int sourceY = 0;
+	int width = source->w;
+	int height = source->h;
+	
+	if ( clip != NULL ) {
+		sourceX = clip->x;
+		sourceY = clip->y;
+		width = clip->w;
+		height = clip->h;
+		
+		// Clipped to the source, moving the destination along.
+		if ( sourceX < 0 ) {
+			width += sourceX;
+			offsetX -= sourceX;
+			sourceX = 0;
+		}
+		if ( sourceY < 0 ) {
+			height += sourceY;
+			offsetY -= sourceY;
+			sourceY = 0;
+		}
+		width = min(width, source->w - sourceX);
+		height = min(height, source->h - sourceY);
+	}
+	
+	// Clipped to the clip rectangle of the destination.
+	const SDL_Rect& bounds = destination->clip_rect;
+	if ( offsetX < bounds.x ) {
+		width -= bounds.x - offsetX;
+		sourceX += bounds.x - offsetX;
+		offsetX = bounds.x;
+	}
+	if ( offsetY < bounds.y ) {
+		height -= bounds.y - offsetY;
+		sourceY += bounds.y - offsetY;
+		offsetY = bounds.y;
+	}
+	width = min(width, bounds.x + bounds.w - offsetX);
+	height = min(height, bounds.y + bounds.h - offsetY);
+	
+	if ( width <= 0 or height <= 0 )
+		return {Sint16(offsetX), Sint16(offsetY), 0, 0};
+	
+	if ( SDL_MUSTLOCK(source) )
+		SDL_LockSurface(source);
+	if ( SDL_MUSTLOCK(destination) )
+		SDL_LockSurface(destination);
+	
+	const Uint8* sourceRow = (const Uint8*)source->pixels +
+	                         sourceY * source->pitch + sourceX * 4;
+	Uint8* destinationRow = (Uint8*)destination->pixels +
+	                        offsetY * destination->pitch + offsetX * 4;
+	
+	for ( int y = 0; y < height; y ++ ) {
+		blendRow((const uint32_t*)sourceRow, (uint32_t*)destinationRow,
+		         width);
+		
+		sourceRow += source->pitch;
+		destinationRow += destination->pitch;
+	}
+	
+	if ( SDL_MUSTLOCK(destination) )
+		SDL_UnlockSurface(destination);
+	if ( SDL_MUSTLOCK(source) )
+		SDL_UnlockSurface(source);
+	
+	return {Sint16(offsetX), Sint16(offsetY), Uint16(width), Uint16(height)};
+}
+
+
+// With SSE2, 4 pixels at a time : groups that are fully transparent are
+// skipped and groups that are fully opaque are copied, as most pixels of
+// a sprite are one or the other.
+void blendRow ( const uint32_t* source, uint32_t* destination, int width )
+{
+	int x = 0;
+	
+#ifdef GALLICA_BLEND_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(int(0xFF000000));
+	const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i full = _mm_set1_epi16(256);
+	
+	for ( ; x + 4 <= width; x += 4 ) {
+		__m128i sourcePixels = _mm_loadu_si128((const __m128i*)(source + x));
+		__m128i alpha = _mm_and_si128(sourcePixels, alphaMask);
+		
+		if ( _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF )
+			continue;
+		
+		__m128i* destinationPixels = (__m128i*)(destination + x);
+		__m128i background = _mm_loadu_si128(destinationPixels);
+		__m128i isOpaque = _mm_cmpeq_epi32(alpha, alphaMask);
+		__m128i color;
+		
+		if ( _mm_movemask_epi8(isOpaque) == 0xFFFF )
+			color = sourcePixels;
+		else {
+			// Every channel as 16 bits : (s * a + d * (256 - a)) >> 8,
+			// which never overflows and equals SDL's d + ((s - d) * a >> 8).
+			__m128i weight = _mm_srli_epi32(sourcePixels, 24);
+			weight = _mm_or_si128(weight, _mm_slli_epi32(weight, 16));
+			__m128i lowWeight = _mm_unpacklo_epi32(weight, weight);
+			__m128i highWeight = _mm_unpackhi_epi32(weight, weight);
+			
+			__m128i low = _mm_add_epi16(
+			              _mm_mullo_epi16(_mm_unpacklo_epi8(sourcePixels,
+			                                                zero), lowWeight),
+			              _mm_mullo_epi16(_mm_unpacklo_epi8(background, zero),
+			                              _mm_sub_epi16(full, lowWeight)));
+			__m128i high = _mm_add_epi16(
+			               _mm_mullo_epi16(_mm_unpackhi_epi8(sourcePixels,
+			                                                 zero), highWeight),
+			               _mm_mullo_epi16(_mm_unpackhi_epi8(background, zero),
+			                               _mm_sub_epi16(full, highWeight)));
+			color = _mm_packus_epi16(_mm_srli_epi16(low, 8),
+			                         _mm_srli_epi16(high, 8));
+			
+			// Opaque pixels are copied, as SDL does.
+			color = _mm_or_si128(_mm_and_si128(isOpaque, sourcePixels),
+			                     _mm_andnot_si128(isOpaque, color));
+		}
+		
+		_mm_storeu_si128(destinationPixels,
+		                 _mm_or_si128(_mm_and_si128(color, colorMask),
+		                              _mm_and_si128(background, alphaMask)));
+	}
+#endif
+	
+	for ( ; x < width; x ++ )
+		destination[x] = blendPixel(source[x], destination[x]);
+}
+
+
+// The color channels of one pixel, with red and blue computed together;
+// the alpha byte of the destination is kept.
+uint32_t blendPixel ( uint32_t source, uint32_t destination )
+{
+	uint32_t alpha = source >> 24;
+	
+	if ( alpha == 0 )
+		return destination;
+	if ( alpha == 255 )
+		return (source & 0x00FFFFFF) | (destination & 0xFF000000);
+	
+	uint32_t redBlue = ((source & 0x00FF00FF) * alpha +
+	                    (destination & 0x00FF00FF) * (256 - alpha)) >> 8;
+	uint32_t green = ((source & 0x0000FF00) * alpha +
+	                  (destination & 0x0000FF00) * (256 - alpha)) >> 8;
+	
+	return (redBlue & 0x00FF00FF) | (green & 0x0000FF00) |
+	       (destination & 0xFF000000);
 }
 
 
@@ -539,15 +2741,25 @@ void applyText ( string text, TTF_Font* font, SDL_Surface* destination,
 }
 
 
+// Does nothing for negative durations.
 void wait ( int milliseconds )
 {
-	Timer timer;
-	timer.start();
+	if ( milliseconds > 0 )
+		sleepUntil(chrono::steady_clock::now() +
+		           chrono::milliseconds(milliseconds));
+}
+
+
+// Sleeps until a deadline minus a margin, then spins on the clock for the
+// rest, which the scheduler could overshoot.
+void sleepUntil ( chrono::steady_clock::time_point deadline,
+                  chrono::steady_clock::duration   spinMargin )
+{
+	if ( chrono::steady_clock::now() < deadline - spinMargin )
+		this_thread::sleep_until(deadline - spinMargin);
 	
-	bool end = false;
-	while ( not end )
-		if ( timer.getTicks() > milliseconds )
-			end = true;
+	while ( chrono::steady_clock::now() < deadline )
+		this_thread::yield();
 }
 
 
@@ -571,24 +2783,152 @@ CollisionData testCollision ( const Circle& circle, const Rectangle& rectangle )
 	else
 		closestYToCircle = circle.positionY;
 	
-	double distance = sqrt(pow(circle.positionX - closestXToCircle, 2) +
-	                       pow(circle.positionY - closestYToCircle, 2));
+	double distanceX = circle.positionX - closestXToCircle;
+	double distanceY = circle.positionY - closestYToCircle;
+	
+	if ( distanceX * distanceX + distanceY * distanceY <
+	     circle.radius * circle.radius )
+		collisionFlags = getCollisionFlags(circle, closestXToCircle,
+		                                   closestYToCircle);
+	
+	return {closestXToCircle, closestYToCircle, collisionFlags};
+}
+
+
+// The flags of a circle colliding with a shape at its closest point.
+uint8_t getCollisionFlags ( const Circle& circle, double closestX,
+                            double closestY )
+{
+	uint8_t collisionFlags = COLLISION_TRUE;
+	
+	if ( circle.positionX < closestX )
+		collisionFlags |= COLLISION_X_NEG;
+	else if ( circle.positionX > closestX )
+		collisionFlags |= COLLISION_X_POS;
+	
+	if ( circle.positionY < closestY )
+		collisionFlags |= COLLISION_Y_NEG;
+	else if ( circle.positionY > closestY )
+		collisionFlags |= COLLISION_Y_POS;
+	
+	return collisionFlags;
+}
+
+
+// The circle moves by (motionX, motionY). Its center is traced against the
+// rectangle grown by the radius, whose corners are rounded : the edges are
+// hit on the grown rectangle, the corners on a circle around them. A circle
+// already colliding hits at time 0 if it moves further in; the normal is
+// null when its center is inside the rectangle.
+SweepData testSweep ( const Circle& circle, double motionX, double motionY,
+                      const Rectangle& rectangle )
+{
+	const SweepData miss = {1.0, 0.0, 0.0, false};
+	
+	double x = circle.positionX;
+	double y = circle.positionY;
+	double radius = circle.radius;
 	
-	if ( distance < circle.radius ) {
-		collisionFlags |= COLLISION_TRUE;
+	CollisionData start = testCollision(circle, rectangle);
+	if ( start.flags & COLLISION_TRUE ) {
+		double normalX = x - start.closestXToFirst;
+		double normalY = y - start.closestYToFirst;
+		double length = sqrt(normalX * normalX + normalY * normalY);
+		
+		if ( length == 0.0 )
+			return {0.0, 0.0, 0.0, true};
 		
-		if ( circle.positionX < closestXToCircle )
-			collisionFlags |= COLLISION_X_NEG;
-		else if ( circle.positionX > closestXToCircle )
-			collisionFlags |= COLLISION_X_POS;
+		normalX /= length;
+		normalY /= length;
+		if ( motionX * normalX + motionY * normalY >= 0.0 )
+			return miss;
 		
-		if ( circle.positionY < closestYToCircle )
-			collisionFlags |= COLLISION_Y_NEG;
-		else if ( circle.positionY > closestYToCircle )
-			collisionFlags |= COLLISION_Y_POS;
+		return {0.0, normalX, normalY, true};
 	}
 	
-	return {closestXToCircle, closestYToCircle, collisionFlags};
+	double innerLeft = rectangle.positionX - rectangle.width / 2;
+	double innerRight = rectangle.positionX + rectangle.width / 2;
+	double innerTop = rectangle.positionY - rectangle.height / 2;
+	double innerBottom = rectangle.positionY + rectangle.height / 2;
+	
+	// Times at which the center enters and leaves the slabs of the grown
+	// rectangle, and the axis entered last (0 : x, 1 : y).
+	double enter = -HUGE_VAL;
+	double leave = HUGE_VAL;
+	int axis = -1;
+	
+	if ( motionX != 0.0 ) {
+		double first = (innerLeft - radius - x) / motionX;
+		double second = (innerRight + radius - x) / motionX;
+		if ( first > second )
+			swap(first, second);
+		
+		if ( first > enter ) {
+			enter = first;
+			axis = 0;
+		}
+		leave = min(leave, second);
+	}
+	else if ( x <= innerLeft - radius or x >= innerRight + radius )
+		return miss;
+	
+	if ( motionY != 0.0 ) {
+		double first = (innerTop - radius - y) / motionY;
+		double second = (innerBottom + radius - y) / motionY;
+		if ( first > second )
+			swap(first, second);
+		
+		if ( first > enter ) {
+			enter = first;
+			axis = 1;
+		}
+		leave = min(leave, second);
+	}
+	else if ( y <= innerTop - radius or y >= innerBottom + radius )
+		return miss;
+	
+	if ( axis == -1 or enter > leave or enter > 1.0 or leave < 0.0 )
+		return miss;
+	
+	double time = max(enter, 0.0);
+	double hitX = x + motionX * time;
+	double hitY = y + motionY * time;
+	
+	SweepData sweep = {time, 0.0, 0.0, true};
+	
+	if ( (hitX < innerLeft or hitX > innerRight) and
+	     (hitY < innerTop or hitY > innerBottom) ) {
+		double cornerX = hitX < innerLeft ? innerLeft : innerRight;
+		double cornerY = hitY < innerTop ? innerTop : innerBottom;
+		
+		// First root of |center + motion * t - corner| = radius
+		double fromCornerX = x - cornerX;
+		double fromCornerY = y - cornerY;
+		double a = motionX * motionX + motionY * motionY;
+		double b = fromCornerX * motionX + fromCornerY * motionY;
+		double c = fromCornerX * fromCornerX + fromCornerY * fromCornerY -
+		           radius * radius;
+		double discriminant = b * b - a * c;
+		
+		if ( discriminant < 0.0 )
+			return miss;
+		
+		sweep.time = (-b - sqrt(discriminant)) / a;
+		if ( sweep.time < 0.0 or sweep.time > 1.0 )
+			return miss;
+		
+		sweep.normalX = (fromCornerX + motionX * sweep.time) / radius;
+		sweep.normalY = (fromCornerY + motionY * sweep.time) / radius;
+	}
+	else if ( axis == 0 )
+		sweep.normalX = motionX > 0.0 ? -1.0 : 1.0;
+	else
+		sweep.normalY = motionY > 0.0 ? -1.0 : 1.0;
+	
+	if ( motionX * sweep.normalX + motionY * sweep.normalY >= 0.0 )
+		return miss;
+	
+	return sweep;
 }
 
 //}
@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : Gallica_LevelFileTest.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Level and settings files read from memory, with the sections
+//               in any order.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../Gallica_LevelFile.hpp"
+#include "Testing.hpp"
+
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+
+//{ Constants
+
+// The obstacles come before and after their count, out of order, with an
+// unknown number, a section of another case and an incomplete section.
+const string LEVEL_TEXT =
+	"[Obstacle2]\n"
+	"imageFileName = Second.png\n"
+	"position = 1000.0 1000.0\n"
+	"width = 150.0\n"
+	"height = 250.0\n"
+	"\n"
+	"[Level]\n"
+	"width = 2000\n"
+	"height = 1500\n"
+	"floorImageFilename = Background.png\n"
+	"maxAiCount = 5\n"
+	"\n"
+	"[Obstacles]\n"
+	"numberOfObstacles = 4\n"
+	"\n"
+	"[OBSTACLE1]\n"
+	"IMAGEFILENAME = First.png\n"
+	"Position = 500.0 400.0\n"
+	"Width = 200.0\n"
+	"Height = 100.0\n"
+	"\n"
+	"[Obstacle7]\n"
+	"imageFileName = Ignored.png\n"
+	"\n"
+	"[Obstacle4]\n"
+	"imageFileName = Incomplete.png\n"
+	"width = 10.0\n"
+	"\n"
+	"[Player]\n"
+	"initPosition = 50.0 60.0\n"
+	"initVelocity = 1.5 -2.0\n"
+	"spriteSheetFilename = Ball.png\n";
+
+//}
+
+
+//{ Functions
+
+void testLevel ( )
+{
+	istringstream levelFile(LEVEL_TEXT);
+	
+	LevelData data = {};
+	Testing::check(LevelFile::findSection(levelFile, "level"),
+	               "[Level] found");
+	LevelFile::readLevelData(levelFile, data);
+	
+	// The widths and heights of the obstacles are not read as the level's.
+	Testing::check(data.width == 2000.0 and data.height == 1500.0,
+	               "level size");
+	Testing::check(data.maxAiCount == 5, "level AI count");
+	Testing::check(data.floorImageFilename == "Background.png",
+	               "level floor image");
+	
+	PlayerData player;
+	Testing::check(LevelFile::findSection(levelFile, "PLAYER"),
+	               "[Player] found");
+	LevelFile::readPlayer(levelFile, player);
+	Testing::check(player.position[0] == 50.0 and player.position[1] == 60.0 and
+	               player.velocity[0] == 1.5 and player.velocity[1] == -2.0,
+	               "player position and velocity");
+	Testing::check(player.spriteSheetFilename == "Ball.png",
+	               "player sprite sheet");
+	
+	Testing::check(not LevelFile::findSection(levelFile, "Enemies"),
+	               "missing section not found");
+}
+
+
+void testObstacles ( )
+{
+	istringstream levelFile(LEVEL_TEXT);
+	vector<ObstacleData> obstacles;
+	
+	LevelFile::findSection(levelFile, "Obstacles");
+	LevelFile::readObstacles(levelFile, obstacles);
+	
+	if ( not Testing::check(obstacles.size() == 4, "obstacle count") )
+		return;
+	
+	Testing::check(obstacles[0].isRead and
+	               obstacles[0].imageFilename == "First.png" and
+	               obstacles[0].position[0] == 500.0 and
+	               obstacles[0].position[1] == 400.0 and
+	               obstacles[0].width == 200.0 and
+	               obstacles[0].height == 100.0,
+	               "obstacle after [Obstacles]");
+	Testing::check(obstacles[1].isRead and
+	               obstacles[1].imageFilename == "Second.png" and
+	               obstacles[1].width == 150.0 and
+	               obstacles[1].height == 250.0,
+	               "obstacle before [Obstacles]");
+	Testing::check(not obstacles[2].isRead, "missing obstacle");
+	Testing::check(not obstacles[3].isRead, "incomplete obstacle");
+}
+
+
+void testSettings ( )
+{
+	istringstream settingsFile("[Window]\n"
+	                           "fontSize = 99\n"
+	                           "\n"
+	                           "[panel]\n"
+	                           "fontFilename = TestFont.ttf\n"
+	                           "fontSize = 20\n");
+	PanelSettings settings = {"Default.ttf", 12};
+	
+	LevelFile::readPanelSettings(settingsFile, settings);
+	Testing::check(settings.fontFilename == "TestFont.ttf" and
+	               settings.fontSize == 20, "panel settings");
+}
+
+
+// The level shipped with the game, when the test runs from its directory.
+void testShippedLevel ( )
+{
+	ifstream levelFile("../Level1");
+	if ( not levelFile )
+		return;
+	
+	vector<ObstacleData> obstacles;
+	LevelFile::findSection(levelFile, "Obstacles");
+	LevelFile::readObstacles(levelFile, obstacles);
+	
+	Testing::check(obstacles.size() == 2 and obstacles[0].isRead and
+	               obstacles[1].isRead, "obstacles of Level1");
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	testLevel();
+	testObstacles();
+	testSettings();
+	testShippedLevel();
+	
+	return Testing::report();
+}
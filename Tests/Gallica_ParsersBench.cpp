@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : Gallica_ParsersBench.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Throughput of the text inputs of the game on generated files :
+//               eval() on matrix elements, Matrix::read and readParallel, and
+//               the readers of "Gallica_LevelFile.hpp".
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../Gallica_LevelFile.hpp"
+#include "Testing.hpp"
+
+#include <sstream>
+
+using namespace std;
+
+
+//{ Functions
+
+// A matrix as the level and test files hold them : decimals, integers and a
+// few repeated fractions.
+string generateMatrix ( int order, Testing::Random& random,
+                        vector<string>& elements )
+{
+	const char* FRACTIONS[] = {"1/3", "-1/2", "2/3", "-3/4"};
+	
+	string text = to_string(order) + " " + to_string(order) + "\n";
+	char buffer[32];
+	
+	for ( int i = 0; i < order; i ++ ) {
+		for ( int j = 0; j < order; j ++ ) {
+			int form = random.uniform(0, 9);
+			if ( form < 5 )
+				snprintf(buffer, sizeof(buffer), "%.4f",
+				         random.uniform(-100.0, 100.0));
+			else if ( form < 9 )
+				snprintf(buffer, sizeof(buffer), "%d", random.uniform(-99, 99));
+			else
+				snprintf(buffer, sizeof(buffer), "%s",
+				         FRACTIONS[random.uniform(0, 3)]);
+			
+			elements.push_back(buffer);
+			text += buffer;
+			text += j + 1 < order ? " " : "\n";
+		}
+	}
+	
+	return text;
+}
+
+
+// A level whose obstacle sections are shuffled around the other sections.
+string generateLevel ( int obstacleCount, Testing::Random& random )
+{
+	vector<string> sections;
+	char buffer[256];
+	
+	sections.push_back("[Level]\nwidth = 20000\nheight = 20000\n"
+	                   "floorImageFilename = Background.png\nmaxAiCount = 5\n");
+	sections.push_back("[Player]\ninitPosition = 50.0 50.0\n"
+	                   "initVelocity = 0.0 0.0\n"
+	                   "spriteSheetFilename = Ball.png\n");
+	sections.push_back("[Obstacles]\nnumberOfObstacles = " +
+	                   to_string(obstacleCount) + "\n");
+	
+	for ( int i = 1; i <= obstacleCount; i ++ ) {
+		snprintf(buffer, sizeof(buffer),
+		         "[Obstacle%d]\nimageFileName = Obstacle.png\n"
+		         "position = %.1f %.1f\nwidth = %.1f\nheight = %.1f\n", i,
+		         random.uniform(0.0, 20000.0), random.uniform(0.0, 20000.0),
+		         random.uniform(10.0, 300.0), random.uniform(10.0, 300.0));
+		sections.push_back(buffer);
+	}
+	
+	for ( int i = int(sections.size()) - 1; i > 0; i -- )
+		swap(sections[i], sections[random.uniform(0, i)]);
+	
+	string text;
+	for ( const string& section : sections )
+		text += section + "\n";
+	
+	return text;
+}
+
+
+void benchmarkMatrices ( Testing::Random& random )
+{
+	const int ORDER = 300;
+	
+	vector<string> elements;
+	string text = generateMatrix(ORDER, random, elements);
+	double bytes = double(text.size());
+	double items = double(elements.size());
+	
+	double seconds = Testing::measure([&] ( ) {
+		double value;
+		for ( const string& element : elements )
+			eval(element, value);
+	});
+	Testing::printRate("eval, matrix elements", bytes, items, seconds);
+	
+	Matrix matrix;
+	
+	seconds = Testing::measure([&] ( ) {
+		istringstream source(text);
+		matrix.read(source);
+	});
+	Testing::printRate("Matrix::read", bytes, items, seconds);
+	
+	ExpressionCache cache;
+	Matrix::readCache = &cache;
+	seconds = Testing::measure([&] ( ) {
+		istringstream source(text);
+		matrix.read(source);
+	});
+	Testing::printRate("Matrix::read, readCache", bytes, items, seconds);
+	Matrix::readCache = NULL;
+	
+	seconds = Testing::measure([&] ( ) {
+		istringstream source(text);
+		matrix.readParallel(source);
+	});
+	Testing::printRate("Matrix::readParallel", bytes, items, seconds);
+}
+
+
+void benchmarkLevels ( Testing::Random& random )
+{
+	for ( int obstacleCount : {10, 1000, 10000} ) {
+		string text = generateLevel(obstacleCount, random);
+		double bytes = double(text.size());
+		string suffix = ", " + to_string(obstacleCount) + " obstacles";
+		
+		double seconds = Testing::measure([&] ( ) {
+			istringstream levelFile(text);
+			LevelData data;
+			PlayerData player;
+			
+			LevelFile::findSection(levelFile, "LEVEL");
+			LevelFile::readLevelData(levelFile, data);
+			LevelFile::findSection(levelFile, "PLAYER");
+			LevelFile::readPlayer(levelFile, player);
+		});
+		// Only the text up to the two sections is read, so no MB/s.
+		Testing::printRate("level and player" + suffix, 0.0, 2, seconds);
+		
+		vector<ObstacleData> obstacles;
+		seconds = Testing::measure([&] ( ) {
+			istringstream levelFile(text);
+			
+			LevelFile::findSection(levelFile, "OBSTACLES");
+			LevelFile::readObstacles(levelFile, obstacles);
+		});
+		Testing::printRate("obstacles" + suffix, bytes, obstacleCount,
+		                   seconds);
+	}
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	Testing::Random random;
+	
+	benchmarkMatrices(random);
+	benchmarkLevels(random);
+	
+	return 0;
+}
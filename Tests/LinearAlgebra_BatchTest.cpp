@@ -0,0 +1,190 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : LinearAlgebra_BatchTest.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 19 2026
+//               Last entry : October 19 2026
+// DESCRIPTION : batchDeterminant, batchInverse and batchSolve compared with
+//               Matrix::determinant, getInverse and solve for the orders 2,
+//               3 and 4, on batches with singular lanes and partial blocks.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../LinearAlgebra_Batch.hpp"
+#include "Testing.hpp"
+
+using namespace std;
+
+
+//{ Functions
+
+// Every 7th lane has a zero row, and every 11th a zero column : each term of
+// the closed forms then has a zero factor, so that their determinants are
+// exactly zero. Two equal rows would leave a rounding error at order 3.
+template <int Order>
+Matrix laneMatrix ( int lane, Testing::Random& random )
+{
+	Matrix generated(Order, Order);
+	
+	for ( int i = 0; i < Order; i ++ )
+		for ( int j = 0; j < Order; j ++ )
+			generated[i][j] = random.uniform(-1.0, 1.0) + (i == j ? Order : 0);
+	
+	if ( lane % 7 == 3 )
+		for ( int j = 0; j < Order; j ++ )
+			generated[Order - 1][j] = 0.0;
+	else if ( lane % 11 == 5 )
+		for ( int i = 0; i < Order; i ++ )
+			generated[i][1] = 0.0;
+	
+	return generated;
+}
+
+
+bool isNear ( double tested, double expected )
+{
+	return fabs(tested - expected) <= 1e-12 * max(1.0, fabs(expected));
+}
+
+
+template <int Order>
+void testBatch ( int count, Testing::Random& random )
+{
+	string name = "order " + to_string(Order) + ", " + to_string(count) +
+	              " lane(s)";
+	
+	SquareMatrixBatch<Order> matrices(count);
+	VectorBatch<Order> constants(count);
+	vector<Matrix> models;
+	vector<Vector> constantModels;
+	
+	for ( int lane = 0; lane < count; lane ++ ) {
+		models.push_back(laneMatrix<Order>(lane, random));
+		matrices.set(lane, models[lane]);
+		
+		Vector constant(Order);
+		for ( int i = 0; i < Order; i ++ )
+			constant[i] = random.uniform(-10.0, 10.0);
+		constantModels.push_back(constant);
+		constants.set(lane, Matrix(constant));
+	}
+	
+	vector<double> determinants(count);
+	vector<uint8_t> inverseFlags(count, 2), solveFlags(count, 2);
+	SquareMatrixBatch<Order> inverses;
+	VectorBatch<Order> solutions;
+	
+	batchDeterminant(matrices, determinants.data());
+	batchInverse(matrices, inverses, inverseFlags.data());
+	batchSolve(matrices, constants, solutions, solveFlags.data());
+	
+	int failures = 0;
+	
+	for ( int lane = 0; lane < count; lane ++ ) {
+		Matrix& model = models[lane];
+		bool isSingular = lane % 7 == 3 or lane % 11 == 5;
+		
+		if ( not isNear(determinants[lane], model.determinant()) )
+			failures ++;
+		if ( inverseFlags[lane] != isSingular or
+		     solveFlags[lane] != isSingular )
+			failures ++;
+		
+		Matrix inverse = inverses.get(lane);
+		Matrix solution = solutions.get(lane);
+		
+		if ( isSingular ) {
+			if ( determinants[lane] != 0.0 )
+				failures ++;
+			
+			for ( int i = 0; i < Order; i ++ ) {
+				if ( solution[i][0] != 0.0 )
+					failures ++;
+				for ( int j = 0; j < Order; j ++ )
+					if ( inverse[i][j] != 0.0 )
+						failures ++;
+			}
+			
+			continue;
+		}
+		
+		Matrix expectedInverse = model.getInverse();
+		Vector expectedSolution = model.solve(constantModels[lane]);
+		
+		for ( int i = 0; i < Order; i ++ ) {
+			if ( not isNear(solution[i][0], expectedSolution[i]) )
+				failures ++;
+			for ( int j = 0; j < Order; j ++ )
+				if ( not isNear(inverse[i][j], expectedInverse[i][j]) )
+					failures ++;
+		}
+	}
+	
+	Testing::check(failures == 0, "batch kernels, " + name + " : " +
+	                              to_string(failures) + " difference(s)");
+	
+	// In place, the results written over the operands.
+	SquareMatrixBatch<Order> inPlace = matrices;
+	batchInverse(inPlace, inPlace, inverseFlags.data());
+	
+	VectorBatch<Order> solvedInPlace = constants;
+	batchSolve(matrices, solvedInPlace, solvedInPlace, solveFlags.data());
+	
+	bool isSame = true;
+	for ( int lane = 0; lane < count; lane ++ )
+		for ( int i = 0; i < Order; i ++ ) {
+			isSame = isSame and solvedInPlace.get(lane)[i][0] ==
+			                    solutions.get(lane)[i][0];
+			for ( int j = 0; j < Order; j ++ )
+				isSame = isSame and inPlace.get(lane)[i][j] ==
+				                    inverses.get(lane)[i][j];
+		}
+	
+	Testing::check(isSame, "batch kernels in place, " + name);
+}
+
+
+// Matrix reports the singular lanes with an exception.
+template <int Order>
+void testSingularModels ( Testing::Random& random )
+{
+	for ( int lane : {3, 5} ) {
+		Matrix model = laneMatrix<Order>(lane, random);
+		
+		bool isThrown = false;
+		try {
+			model.getInverse();
+		}
+		catch ( LinAlgError& ) {
+			isThrown = true;
+		}
+		
+		Testing::check(isThrown, "getInverse of singular lane " +
+		               to_string(lane) + ", order " + to_string(Order));
+	}
+}
+
+
+template <int Order>
+void testOrder ( Testing::Random& random )
+{
+	// Partial and full blocks of SmallMatrix::BLOCK_LANES lanes.
+	for ( int count : {0, 1, 5, 31, 32, 33, 64, 100} )
+		testBatch<Order>(count, random);
+	
+	testSingularModels<Order>(random);
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	Testing::Random random;
+	
+	testOrder<2>(random);
+	testOrder<3>(random);
+	testOrder<4>(random);
+	
+	return Testing::report();
+}
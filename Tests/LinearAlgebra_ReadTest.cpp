@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : LinearAlgebra_ReadTest.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 19 2026
+//               Last entry : October 19 2026
+// DESCRIPTION : Matrix::read, Matrix::readParallel and Vector::read on
+//               complete and truncated inputs, with and without readCache.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../LinearAlgebra.hpp"
+#include "Testing.hpp"
+
+#include <sstream>
+
+using namespace std;
+
+
+//{ Functions
+
+// The code of the ParseError thrown by the reading, NONE without one.
+template <typename Reading>
+ParseErr::Code readError ( Reading reading )
+{
+	try {
+		reading();
+	}
+	catch ( ParseError& error ) {
+		return error.getCode();
+	}
+	
+	return ParseErr::NONE;
+}
+
+
+void testMatrix ( const string& name )
+{
+	Matrix read;
+	istringstream complete("2 2 1 2 3 4/2");
+	
+	Testing::check(readError([&] ( ) { read.read(complete); }) ==
+	               ParseErr::NONE and
+	               read.element(0, 0) == 1.0 and read.element(0, 1) == 2.0 and
+	               read.element(1, 0) == 3.0 and read.element(1, 1) == 2.0,
+	               "Matrix::read of a complete matrix, " + name);
+	
+	// The last element read must not be taken again for the missing ones.
+	for ( string text : {"2 2 1 2 3", "2 2", "1 3 1 2", "2 1 5\n"} ) {
+		istringstream truncated(text);
+		
+		Testing::check(readError([&] ( ) { read.read(truncated); }) ==
+		               ParseErr::EMPTY,
+		               "Matrix::read of \"" + text + "\", " + name);
+	}
+}
+
+
+void testParallel ( )
+{
+	for ( int threads : {1, 2, 4} ) {
+		Matrix read;
+		istringstream truncated("3 3 1 2 3 4 5 6 7 8");
+		
+		Testing::check(readError([&] ( ) {
+		                   read.readParallel(truncated, threads);
+		               }) == ParseErr::EMPTY,
+		               "Matrix::readParallel of a truncated matrix, " +
+		               to_string(threads) + " thread(s)");
+	}
+}
+
+
+void testVector ( const string& name )
+{
+	Vector read;
+	istringstream complete("3 1 2 1+2");
+	
+	Testing::check(readError([&] ( ) { read.read(complete); }) ==
+	               ParseErr::NONE and
+	               read[0] == 1.0 and read[1] == 2.0 and read[2] == 3.0,
+	               "Vector::read of a complete vector, " + name);
+	
+	for ( string text : {"3 1 2", "3", "1\n"} ) {
+		istringstream truncated(text);
+		
+		Testing::check(readError([&] ( ) { read.read(truncated); }) ==
+		               ParseErr::EMPTY,
+		               "Vector::read of \"" + text + "\", " + name);
+	}
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	testMatrix("without cache");
+	testVector("without cache");
+	testParallel();
+	
+	ExpressionCache cache;
+	Matrix::readCache = &cache;
+	
+	testMatrix("with readCache");
+	testVector("with readCache");
+	
+	Matrix::readCache = NULL;
+	
+	return Testing::report();
+}
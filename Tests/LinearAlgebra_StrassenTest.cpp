@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : LinearAlgebra_StrassenTest.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Strassen products compared with the classical kernel, for
+//               orders that need padding and with the threaded top level.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../LinearAlgebra.hpp"
+#include "Testing.hpp"
+
+using namespace std;
+
+
+//{ Functions
+
+Matrix randomMatrix ( int order, Testing::Random& random )
+{
+	Matrix generated(order, order);
+	
+	for ( int i = 0; i < order; i ++ )
+		for ( int j = 0; j < order; j ++ )
+			generated[i][j] = random.uniform(-1.0, 1.0);
+	
+	return generated;
+}
+
+
+Matrix classicalProduct ( const Matrix& leftTerm, const Matrix& rightTerm )
+{
+	int savedCrossover = Matrix::strassenCrossover;
+	Matrix::strassenCrossover = 0;
+	
+	Matrix product = leftTerm * rightTerm;
+	
+	Matrix::strassenCrossover = savedCrossover;
+	return product;
+}
+
+
+// Largest difference between the elements, relative to the bound n |a| |b| of
+// the elements of a product of order n.
+double relativeError ( const Matrix& tested, const Matrix& expected,
+                       double magnitude )
+{
+	double error = 0.0;
+	
+	for ( int i = 0; i < expected.getHeight(); i ++ )
+		for ( int j = 0; j < expected.getWidth(); j ++ )
+			error = max(error, fabs(tested.element(i, j) -
+			                        expected.element(i, j)));
+	
+	return error / magnitude;
+}
+
+
+void testOrders ( int crossover, int threads, Testing::Random& random )
+{
+	// Orders around the powers of two, so that some are padded once at the
+	// top and others at several levels of the recursion.
+	const int ORDERS[] = {1, 2, 3, 5, 7, 16, 17, 31, 33, 63, 64, 65, 100, 129,
+	                      200};
+	
+	Matrix::strassenCrossover = crossover;
+	Matrix::strassenThreads = threads;
+	
+	for ( int order : ORDERS ) {
+		Matrix left = randomMatrix(order, random);
+		Matrix right = randomMatrix(order, random);
+		Matrix expected = classicalProduct(left, right);
+		
+		string name = "order " + to_string(order) + ", crossover " +
+		              to_string(crossover) + ", " + to_string(threads) +
+		              " thread(s)";
+		
+		// Strassen loses a few digits more than the classical product per
+		// level, far from this bound on the rounding errors.
+		Testing::check(relativeError(left.strassenProduct(right), expected,
+		                             order) < 1e-12,
+		               "strassenProduct, " + name);
+		Testing::check(relativeError(left * right, expected, order) < 1e-12,
+		               "operator * above the crossover, " + name);
+	}
+}
+
+
+// Structured operands are made dense before the recursion.
+void testStructured ( Testing::Random& random )
+{
+	Matrix::strassenCrossover = 4;
+	Matrix::strassenThreads = 2;
+	
+	Matrix diagonal(37, DIAGONAL);
+	for ( int i = 0; i < 37; i ++ )
+		diagonal.setElement(i, i, random.uniform(-1.0, 1.0));
+	
+	Matrix dense = randomMatrix(37, random);
+	
+	Testing::check(relativeError(diagonal.strassenProduct(dense),
+	                             classicalProduct(diagonal, dense), 37) < 1e-12,
+	               "strassenProduct with a diagonal operand");
+}
+
+
+void testErrors ( )
+{
+	bool isThrown = false;
+	try {
+		Matrix(3, 4).strassenProduct(Matrix(4, 3));
+	}
+	catch ( LinAlgError& ) {
+		isThrown = true;
+	}
+	Testing::check(isThrown, "strassenProduct of non square matrices");
+	
+	isThrown = false;
+	try {
+		Matrix(3, 3).strassenProduct(Matrix(4, 4));
+	}
+	catch ( LinAlgError& ) {
+		isThrown = true;
+	}
+	Testing::check(isThrown, "strassenProduct of different orders");
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	Testing::Random random;
+	
+	for ( int crossover : {1, 4, 16} )
+		for ( int threads : {1, 2, 7} )
+			testOrders(crossover, threads, random);
+	
+	testStructured(random);
+	testErrors();
+	
+	return Testing::report();
+}
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : MathParser_EvalBench.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Throughput of eval(string_view, double&) on generated numbers
+//               and expressions, with strtod as the reference for numbers.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../MathParser.hpp"
+#include "Testing.hpp"
+
+#include <cstdlib>
+
+using namespace std;
+
+
+//{ Functions
+
+// Texts of the given form, as matrix and level files hold them.
+vector<string> generateTexts ( int form, int count, Testing::Random& random )
+{
+	const char* FRACTIONS[] = {"1/3", "-1/2", "2/3", "-3/4", "0", "1"};
+	
+	vector<string> texts;
+	char buffer[64];
+	
+	for ( int i = 0; i < count; i ++ ) {
+		if ( form == 0 )
+			snprintf(buffer, sizeof(buffer), "%d", random.uniform(-9999, 9999));
+		else if ( form == 1 )
+			snprintf(buffer, sizeof(buffer), "%.6f",
+			         random.uniform(-1000.0, 1000.0));
+		else if ( form == 2 )
+			snprintf(buffer, sizeof(buffer), "%.15g",
+			         random.uniform(-1.0, 1.0) * 1e-20);
+		else if ( form == 3 )
+			snprintf(buffer, sizeof(buffer), "%s",
+			         FRACTIONS[random.uniform(0, 5)]);
+		else
+			snprintf(buffer, sizeof(buffer), "%d * (%.3f - sqrt(%d)) / 2",
+			         random.uniform(1, 99), random.uniform(0.0, 10.0),
+			         random.uniform(1, 999));
+		
+		texts.push_back(buffer);
+	}
+	
+	return texts;
+}
+
+
+size_t totalSize ( const vector<string>& texts )
+{
+	size_t size = 0;
+	for ( const string& text : texts )
+		size += text.size();
+	
+	return size;
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	const char* FORM_NAMES[] = {"integers", "decimals", "scientific",
+	                            "fractions", "expressions"};
+	const int COUNT = 100000;
+	
+	Testing::Random random;
+	volatile double sink = 0.0;
+	
+	for ( int form = 0; form < 5; form ++ ) {
+		vector<string> texts = generateTexts(form, COUNT, random);
+		double bytes = double(totalSize(texts));
+		
+		double seconds = Testing::measure([&] ( ) {
+			double sum = 0.0, value;
+			for ( const string& text : texts )
+				if ( eval(text, value) == ParseErr::NONE )
+					sum += value;
+			sink = sum;
+		});
+		Testing::printRate(string("eval, ") + FORM_NAMES[form], bytes, COUNT,
+		                   seconds);
+		
+		if ( form > 2 )
+			continue;
+		
+		seconds = Testing::measure([&] ( ) {
+			double sum = 0.0;
+			for ( const string& text : texts )
+				sum += strtod(text.c_str(), NULL);
+			sink = sum;
+		});
+		Testing::printRate(string("strtod, ") + FORM_NAMES[form], bytes,
+		                   COUNT, seconds);
+	}
+	
+	return 0;
+}
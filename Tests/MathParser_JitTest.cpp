@@ -0,0 +1,184 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : MathParser_JitTest.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Native code of NativeExpression compared with the interpreter
+//               of Expression, which runs the same program and so must give
+//               the same bits.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../MathParser_Jit.hpp"
+#include "Testing.hpp"
+
+using namespace std;
+
+
+//{ Constants
+
+const vector<string> VARIABLES = {"x", "y", "z", "w"};
+
+//}
+
+
+//{ Functions
+
+bool isSame ( double first, double second )
+{
+	if ( isnan(first) or isnan(second) )
+		return isnan(first) and isnan(second);
+	
+	return memcmp(&first, &second, sizeof(double)) == 0;
+}
+
+
+string randomConstant ( Testing::Random& random )
+{
+	char buffer[32];
+	
+	if ( random.uniform(0, 1) )
+		snprintf(buffer, sizeof(buffer), "%d", random.uniform(0, 9));
+	else
+		snprintf(buffer, sizeof(buffer), "%.6g", random.uniform(0.0, 100.0));
+	
+	return buffer;
+}
+
+
+// Random arithmetic with variables, constants, negations and parentheses.
+string randomExpression ( int levels, Testing::Random& random )
+{
+	const char OPERATORS[] = "+-*/";
+	
+	int choice = levels > 0 ? random.uniform(0, 9) : random.uniform(0, 1);
+	
+	if ( choice == 0 )
+		return VARIABLES[random.uniform(0, 3)];
+	if ( choice == 1 )
+		return randomConstant(random);
+	if ( choice == 2 )
+		return "-" + randomExpression(levels - 1, random);
+	
+	return "(" + randomExpression(levels - 1, random) +
+	       OPERATORS[random.uniform(0, 3)] +
+	       randomExpression(levels - 1, random) + ")";
+}
+
+
+// Evaluates both ways on random values; returns false on the first mismatch.
+bool compare ( const string& text, Testing::Random& random,
+               bool isNativeExpected )
+{
+	Expression expression(text, VARIABLES);
+	NativeExpression native(expression);
+	
+	#ifdef GALLICA_JIT
+	if (
+		not Testing::check(native.isNative() == isNativeExpected,
+		                   "native code generated for " + text) )
+		return false;
+	#else
+	(void)isNativeExpected;
+	#endif
+	
+	for ( int i = 0; i < 20; i ++ ) {
+		double values[4];
+		for ( double& value : values )
+			value = random.uniform(0, 7) == 0 ? 0.0 :
+			        random.uniform(-1000.0, 1000.0);
+		
+		if (
+			not Testing::check(isSame(native.evaluate(values),
+			                          expression.evaluate(values)),
+			                   "same result for " + text) )
+			return false;
+	}
+	
+	return true;
+}
+
+
+// Right nested sums hold one more value on the stack per term, so n terms
+// reach the depth n. Each term is a load, a negation or an operation with a
+// constant, to use every instruction form in the registers xmm8 to xmm15.
+string nestedExpression ( int terms, int form )
+{
+	const string TERMS[] = {"x", "-y", "z*2.5", "-(w/3)", "(x-0.125)"};
+	
+	string text;
+	for ( int i = 0; i < terms - 1; i ++ )
+		text += TERMS[(i + form) % 5] + "+(";
+	
+	text += TERMS[(terms - 1 + form) % 5];
+	
+	return text + string(terms - 1, ')');
+}
+
+
+// Trees of at most 6 levels hold at most 7 values, so they are all native.
+void testRandom ( Testing::Random& random )
+{
+	for ( int i = 0; i < 20000; i ++ )
+		if ( not compare(randomExpression(random.uniform(1, 6), random), random,
+		                 true) )
+			return;
+}
+
+
+void testDepths ( Testing::Random& random )
+{
+	for ( int terms = 1; terms <= 20; terms ++ )
+		for ( int form = 0; form < 5; form ++ )
+			if (
+				not compare(nestedExpression(terms, form), random,
+				            terms <= 16) )
+				return;
+}
+
+
+// Distinct constants, each one in the pool after the sign mask.
+void testConstantPool ( Testing::Random& random )
+{
+	string text = "x";
+	for ( int i = 1; i <= 200; i ++ )
+		text += (i % 2 ? "+y*" : "-z/") + to_string(i) + ".5";
+	
+	compare(text, random, true);
+	compare("-x", random, true);
+	compare("-(-(-x))", random, true);
+	compare("3.75", random, true);
+	compare("-0.0+x", random, true);
+}
+
+
+void testFallbacks ( Testing::Random& random )
+{
+	compare("x^2", random, false);
+	compare("x+y^3", random, false);
+	compare("sqrt(abs(x))*y", random, false);
+	compare("x+floor(y)", random, false);
+	
+	NativeExpression::isEnabled = false;
+	compare("x+y*z", random, false);
+	compare("-x", random, false);
+	NativeExpression::isEnabled = true;
+	
+	compare("x+y*z", random, true);
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	Testing::Random random;
+	
+	testRandom(random);
+	testDepths(random);
+	testConstantPool(random);
+	testFallbacks(random);
+	
+	return Testing::report();
+}
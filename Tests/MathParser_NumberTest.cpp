@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : MathParser_NumberTest.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : The plain number path of eval() compared with the grammar.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../MathParser.hpp"
+#include "Testing.hpp"
+
+#include <cstring>
+
+using namespace std;
+
+
+//{ Functions
+
+// The result of the grammar alone, without the plain number path.
+ParseErr::Code parseWithGrammar ( string_view text, double& result )
+{
+	Parsing::Calculator calculator;
+	Parsing::Parser<Parsing::Calculator> parser(text, calculator);
+	
+	ParseErr::Code code = parser.parse();
+	if ( code == ParseErr::NONE )
+		result = calculator.getResult();
+	
+	return code;
+}
+
+
+string randomDigits ( int count, Testing::Random& random )
+{
+	string digits;
+	for ( int i = 0; i < count; i ++ )
+		digits += char('0' + random.uniform(0, 9));
+	
+	return digits;
+}
+
+
+// Numbers in every form of the grammar, with blanks and signs around them.
+string randomNumber ( Testing::Random& random )
+{
+	const char* SIGNS[] = {"", "", "-", "+"};
+	const char* BLANKS[] = {"", "", " ", "\t"};
+	
+	string number = SIGNS[random.uniform(0, 3)];
+	
+	int form = random.uniform(0, 3);
+	if ( form == 0 )
+		number += randomDigits(random.uniform(1, 20), random);
+	else if ( form == 1 )
+		number += randomDigits(random.uniform(0, 8), random) + "." +
+		          randomDigits(random.uniform(1, 12), random);
+	else if ( form == 2 )
+		number += randomDigits(random.uniform(1, 8), random) + ".";
+	else
+		number += randomDigits(random.uniform(1, 6), random) + "." +
+		          randomDigits(random.uniform(0, 6), random) +
+		          (random.uniform(0, 1) ? "e" : "E") +
+		          SIGNS[random.uniform(0, 3)] +
+		          randomDigits(random.uniform(1, 3), random);
+	
+	return BLANKS[random.uniform(0, 3)] + number + BLANKS[random.uniform(0, 3)];
+}
+
+
+void testNumbers ( Testing::Random& random )
+{
+	for ( int i = 0; i < 100000; i ++ ) {
+		string text = randomNumber(random);
+		
+		double fast = 0.0, parsed = 0.0;
+		ParseErr::Code fastCode = eval(text, fast);
+		ParseErr::Code parsedCode = parseWithGrammar(text, parsed);
+		
+		if (
+			not Testing::check(fastCode == parsedCode and
+			                   memcmp(&fast, &parsed, sizeof(double)) == 0,
+			                   "eval(\"" + text + "\") against the grammar") )
+			return;
+	}
+}
+
+
+// from_chars reads these, the grammar doesn't.
+void testRejected ( )
+{
+	const char* TEXTS[] = {"inf", "-inf", "+inf", "INF", "infinity", "nan",
+	                       "-nan", "NaN", "nan(1)", " inf ", "-", "+", ".",
+	                       "-.", "1e", "1e+", "0x10", "--1", "1 2"};
+	
+	for ( const char* text : TEXTS ) {
+		double fast = 0.0, parsed = 0.0;
+		
+		Testing::check(parseNumber(text, fast) != ParseErr::NONE,
+		               string("parseNumber(\"") + text + "\") is rejected");
+		Testing::check(eval(text, fast) == parseWithGrammar(text, parsed),
+		               string("eval(\"") + text + "\") fails like the grammar");
+	}
+	
+	bool isThrown = false;
+	try {
+		eval("nan");
+	}
+	catch ( ParseError& ) {
+		isThrown = true;
+	}
+	Testing::check(isThrown, "eval(\"nan\") throws");
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	Testing::Random random;
+	
+	testNumbers(random);
+	testRejected();
+	
+	return Testing::report();
+}
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : SdlUtility_BlendBench.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Time of blendSurface and of SDL_BlitSurface for sprites with
+//               per pixel alpha, from 8x8 to 512x512, blitted to a 32 bit
+//               surface large enough for all of them.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../SdlUtility.hpp"
+#include "Testing.hpp"
+
+using namespace std;
+
+
+//{ Functions
+
+// A disc with a soft edge on a transparent background, as the sprites are :
+// opaque inside, transparent in the corners and translucent between.
+SDL_Surface* createSprite ( int size, Testing::Random& random )
+{
+	SDL_Surface* sprite = SDL_CreateRGBSurface(SDL_SWSURFACE | SDL_SRCALPHA,
+	                                           size, size, 32, 0x00FF0000,
+	                                           0x0000FF00, 0x000000FF,
+	                                           0xFF000000);
+	double radius = size / 2.0;
+	
+	for ( int y = 0; y < size; y ++ ) {
+		Uint32* row = (Uint32*)((Uint8*)sprite->pixels + y * sprite->pitch);
+		
+		for ( int x = 0; x < size; x ++ ) {
+			double distance = hypot(x + 0.5 - radius, y + 0.5 - radius);
+			double coverage = min(max((radius - distance) / 2.0, 0.0), 1.0);
+			
+			row[x] = (uint32_t(random.next()) & 0x00FFFFFF) |
+			         Uint32(coverage * 255.0 + 0.5) << 24;
+		}
+	}
+	
+	return sprite;
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	const int SCREEN_WIDTH = 1024;
+	const int SCREEN_HEIGHT = 768;
+	
+	Testing::Random random;
+	
+	SDL_Surface* screen = SDL_CreateRGBSurface(SDL_SWSURFACE, SCREEN_WIDTH,
+	                                           SCREEN_HEIGHT, 32, 0x00FF0000,
+	                                           0x0000FF00, 0x000000FF, 0);
+	
+	for ( int size : {8, 32, 128, 512} ) {
+		SDL_Surface* sprite = createSprite(size, random);
+		
+		if ( not Sdl::canBlend(sprite, screen) ) {
+			cout << size << "x" << size << " sprite : blendSurface can't be "
+			     << "used with these formats" << endl;
+			SDL_FreeSurface(sprite);
+			continue;
+		}
+		
+		// Positions spread over the screen, all inside it.
+		vector<SDL_Rect> positions;
+		for ( int i = 0; i < 64; i ++ ) {
+			int x = random.uniform(0, SCREEN_WIDTH - size);
+			int y = random.uniform(0, SCREEN_HEIGHT - size);
+			
+			positions.push_back({Sint16(x), Sint16(y), 0, 0});
+		}
+		
+		string name = to_string(size) + "x" + to_string(size) + " sprite, ";
+		double pixels = double(size) * size;
+		int next = 0;
+		
+		double seconds = Testing::measure([&] ( ) {
+			Sdl::blendSurface(sprite, screen, positions[next].x,
+			                  positions[next].y);
+			next = (next + 1) % int(positions.size());
+		});
+		Testing::printRate(name + "blendSurface", pixels * 4.0, pixels,
+		                   seconds);
+		
+		seconds = Testing::measure([&] ( ) {
+			SDL_Rect position = positions[next];  // SDL writes the clipping.
+			SDL_BlitSurface(sprite, NULL, screen, &position);
+			next = (next + 1) % int(positions.size());
+		});
+		Testing::printRate(name + "SDL_BlitSurface", pixels * 4.0, pixels,
+		                   seconds);
+		
+		SDL_FreeSurface(sprite);
+	}
+	
+	SDL_FreeSurface(screen);
+	
+	return 0;
+}
@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : SdlUtility_BlendTest.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : blendPixel and blendRow compared pixel for pixel with the
+//               formula of SDL 1.2, on random rows of every length up to a
+//               few groups of 4 pixels, so that the scalar tails are tested
+//               after the SSE2 groups.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../SdlUtility.hpp"
+#include "Testing.hpp"
+
+#include <sstream>
+
+using namespace std;
+
+
+//{ Functions
+
+// SDL 1.2 per channel, d + ((s - d) * a >> 8), with the opaque pixels copied
+// and the alpha byte of the destination kept.
+uint32_t sdlBlendPixel ( uint32_t source, uint32_t destination )
+{
+	int alpha = source >> 24;
+	
+	if ( alpha == 255 )
+		return (source & 0x00FFFFFF) | (destination & 0xFF000000);
+	
+	uint32_t blended = destination & 0xFF000000;
+	
+	for ( int shift = 0; shift < 24; shift += 8 ) {
+		int s = (source >> shift) & 0xFF;
+		int d = (destination >> shift) & 0xFF;
+		
+		blended |= uint32_t(d + ((s - d) * alpha >> 8)) << shift;
+	}
+	
+	return blended;
+}
+
+
+string toHex ( uint32_t pixel )
+{
+	ostringstream text;
+	text << hex << setw(8) << setfill('0') << pixel;
+	
+	return text.str();
+}
+
+
+// Mostly transparent and opaque pixels, as in sprites, so that whole groups
+// are skipped or copied, with translucent ones between.
+uint32_t randomSourcePixel ( Testing::Random& random, int kind )
+{
+	uint32_t color = uint32_t(random.next()) & 0x00FFFFFF;
+	
+	switch ( kind ) {
+		case 0 : return color;
+		case 1 : return color | 0xFF000000;
+		case 2 : return color | uint32_t(random.uniform(1, 254)) << 24;
+		default : return uint32_t(random.next());
+	}
+}
+
+
+// Every alpha against random colors, and the extremes of each channel.
+void testPixels ( Testing::Random& random )
+{
+	const uint32_t EXTREMES[] = {0x00000000, 0x00FFFFFF, 0x00FF00FF,
+	                             0x0000FF00, 0xFF000000, 0xFFFFFFFF};
+	
+	int failures = 0;
+	
+	for ( uint32_t alpha = 0; alpha < 256; alpha ++ ) {
+		for ( int i = 0; i < 1000; i ++ ) {
+			uint32_t source = (uint32_t(random.next()) & 0x00FFFFFF) |
+			                  alpha << 24;
+			uint32_t destination = uint32_t(random.next());
+			
+			if ( Sdl::blendPixel(source, destination) !=
+			     sdlBlendPixel(source, destination) )
+				failures ++;
+		}
+		
+		for ( uint32_t sourceColor : EXTREMES )
+			for ( uint32_t destination : EXTREMES ) {
+				uint32_t source = (sourceColor & 0x00FFFFFF) | alpha << 24;
+				
+				if ( Sdl::blendPixel(source, destination) !=
+				     sdlBlendPixel(source, destination) )
+					failures ++;
+			}
+	}
+	
+	Testing::check(failures == 0, "blendPixel, " + to_string(failures) +
+	                              " pixel(s) differ from SDL");
+}
+
+
+// Rows of every length from 0 to 4 groups and a tail, then longer ones, at
+// every offset from an aligned address. The pixels around the row must not
+// be written.
+void testRows ( Testing::Random& random )
+{
+	const int GUARD = 4;
+	
+	vector<int> lengths;
+	for ( int length = 0; length <= 19; length ++ )
+		lengths.push_back(length);
+	for ( int length : {63, 64, 65, 66, 67, 640, 1021} )
+		lengths.push_back(length);
+	
+	for ( int length : lengths )
+		for ( int offset = 0; offset < 4; offset ++ )
+			for ( int trial = 0; trial < 50; trial ++ ) {
+				int start = GUARD + offset;
+				
+				vector<uint32_t> source(start + length + GUARD);
+				vector<uint32_t> destination(source.size());
+				
+				// Runs of one kind of pixel, long enough to fill groups.
+				int kind = random.uniform(0, 3);
+				for ( int i = 0; i < int(source.size()); i ++ ) {
+					if ( random.uniform(0, 5) == 0 )
+						kind = random.uniform(0, 3);
+					
+					source[i] = randomSourcePixel(random, kind);
+					destination[i] = uint32_t(random.next());
+				}
+				
+				vector<uint32_t> expected = destination;
+				for ( int i = start; i < start + length; i ++ )
+					expected[i] = sdlBlendPixel(source[i], destination[i]);
+				
+				Sdl::blendRow(&source[start], &destination[start], length);
+				
+				for ( int i = 0; i < int(expected.size()); i ++ )
+					if ( destination[i] != expected[i] ) {
+						Testing::check(false, "blendRow, length " +
+						               to_string(length) + ", offset " +
+						               to_string(offset) + ", pixel " +
+						               to_string(i - start) + " : " +
+						               toHex(destination[i]) + " instead of " +
+						               toHex(expected[i]));
+						break;
+					}
+			}
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	Testing::Random random;
+	
+	testPixels(random);
+	testRows(random);
+	
+	return Testing::report();
+}
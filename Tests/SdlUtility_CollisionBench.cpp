@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : SdlUtility_CollisionBench.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Time of RectangleBatch::testCollisions for one circle, with
+//               and without the grid, for batches of up to 100000 rectangles.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../SdlUtility.hpp"
+#include "Testing.hpp"
+
+using namespace std;
+
+
+int main ( )
+{
+	const int CIRCLE_COUNT = 1024;
+	
+	Testing::Random random;
+	
+	for ( int rectangleCount : {1000, 10000, 100000} ) {
+		// About as dense as the levels : 2 % of the area is covered.
+		double side = sqrt(rectangleCount * 25.0 * 25.0 / 0.02);
+		
+		Sdl::RectangleBatch batch;
+		for ( int i = 0; i < rectangleCount; i ++ )
+			batch.add({random.uniform(0.0, side), random.uniform(0.0, side),
+			           random.uniform(10.0, 40.0), random.uniform(10.0, 40.0)});
+		
+		for ( double radius : {20.0, 200.0} ) {
+			vector<Sdl::Circle> circles;
+			for ( int i = 0; i < CIRCLE_COUNT; i ++ )
+				circles.push_back({random.uniform(0.0, side),
+				                   random.uniform(0.0, side), radius});
+			
+			for ( bool isGridEnabled : {false, true} ) {
+				Sdl::RectangleBatch::isGridEnabled = isGridEnabled;
+				batch.set(0, batch.getRectangle(0));  // Rebuilds the grid.
+				
+				vector<Sdl::CollisionHit> hits;
+				int next = 0;
+				
+				double seconds = Testing::measure([&] ( ) {
+					hits.clear();
+					batch.testCollisions(circles[next], hits);
+					next = (next + 1) % CIRCLE_COUNT;
+				});
+				
+				Testing::printRate(to_string(rectangleCount) +
+				                   " rectangles, radius " +
+				                   to_string(int(radius)) +
+				                   (isGridEnabled ? ", grid" : ", scan"),
+				                   0.0, rectangleCount, seconds);
+			}
+		}
+	}
+	
+	return 0;
+}
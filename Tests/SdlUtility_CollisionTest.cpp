@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : SdlUtility_CollisionTest.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : RectangleBatch::testCollisions compared with testCollision()
+//               on every rectangle, with and without the grid.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../SdlUtility.hpp"
+#include "Testing.hpp"
+
+using namespace std;
+
+
+//{ Functions
+
+// The hits of testCollision(), by order of circle then rectangle.
+void findHits ( const vector<Sdl::Circle>& circles,
+                const vector<Sdl::Rectangle>& rectangles,
+                vector<Sdl::CollisionHit>& hits )
+{
+	for ( int c = 0; c < int(circles.size()); c ++ )
+		for ( int i = 0; i < int(rectangles.size()); i ++ ) {
+			Sdl::CollisionData data = Sdl::testCollision(circles[c],
+			                                             rectangles[i]);
+			if ( data.flags & Sdl::COLLISION_TRUE )
+				hits.push_back({c, i, data});
+		}
+}
+
+
+bool isSame ( const vector<Sdl::CollisionHit>& tested,
+              const vector<Sdl::CollisionHit>& expected )
+{
+	if ( tested.size() != expected.size() )
+		return false;
+	
+	for ( size_t i = 0; i < tested.size(); i ++ ) {
+		const Sdl::CollisionHit& hit = tested[i];
+		const Sdl::CollisionHit& expectedHit = expected[i];
+		
+		if (
+			hit.circleIndex != expectedHit.circleIndex or
+			hit.rectangleIndex != expectedHit.rectangleIndex or
+			hit.data.closestXToFirst != expectedHit.data.closestXToFirst or
+			hit.data.closestYToFirst != expectedHit.data.closestYToFirst or
+			hit.data.flags != expectedHit.data.flags )
+			return false;
+	}
+	
+	return true;
+}
+
+
+// Small and large rectangles, some far from the others, some flat, and
+// circles from points to a quarter of the area, some outside of it.
+void testScene ( int rectangleCount, Testing::Random& random )
+{
+	vector<Sdl::Rectangle> rectangles;
+	for ( int i = 0; i < rectangleCount; i ++ ) {
+		int kind = random.uniform(0, 19);
+		double size = kind == 0 ? 2000.0 : kind == 1 ? 0.0 : 40.0;
+		
+		rectangles.push_back({random.uniform(0.0, 5000.0),
+		                      random.uniform(0.0, 5000.0),
+		                      random.uniform(0.0, size),
+		                      random.uniform(0.0, size)});
+	}
+	if ( rectangleCount > 0 )
+		rectangles[0] = {-40000.0, 90000.0, 10.0, 10.0};
+	
+	vector<Sdl::Circle> circles;
+	for ( int i = 0; i < 500; i ++ ) {
+		double radius = random.uniform(0, 9) == 0 ?
+		                random.uniform(0.0, 1250.0) :
+		                random.uniform(0.0, 30.0);
+		
+		circles.push_back({random.uniform(-500.0, 5500.0),
+		                   random.uniform(-500.0, 5500.0), radius});
+	}
+	
+	// Circles right on the corners and the edges of rectangles.
+	for ( int i = 0; i < min(rectangleCount, 200); i ++ ) {
+		const Sdl::Rectangle& rectangle = rectangles[i];
+		circles.push_back({rectangle.positionX + rectangle.width / 2,
+		                   rectangle.positionY - rectangle.height / 2,
+		                   random.uniform(0.0, 5.0)});
+	}
+	
+	vector<Sdl::CollisionHit> expected;
+	findHits(circles, rectangles, expected);
+	
+	for ( bool isGridEnabled : {true, false} ) {
+		Sdl::RectangleBatch::isGridEnabled = isGridEnabled;
+		
+		Sdl::RectangleBatch batch;
+		for ( const Sdl::Rectangle& rectangle : rectangles )
+			batch.add(rectangle);
+		
+		vector<Sdl::CollisionHit> hits;
+		batch.testCollisions(circles.data(), int(circles.size()), hits);
+		
+		Testing::check(isSame(hits, expected),
+		               to_string(rectangleCount) + " rectangles, grid " +
+		               (isGridEnabled ? "on" : "off"));
+	}
+	
+	Sdl::RectangleBatch::isGridEnabled = true;
+}
+
+
+// The grid follows the rectangles moved after a test.
+void testChanges ( Testing::Random& random )
+{
+	vector<Sdl::Rectangle> rectangles;
+	Sdl::RectangleBatch batch;
+	for ( int i = 0; i < 1000; i ++ ) {
+		rectangles.push_back({random.uniform(0.0, 3000.0),
+		                      random.uniform(0.0, 3000.0), 20.0, 20.0});
+		batch.add(rectangles.back());
+	}
+	
+	vector<Sdl::Circle> circles = {{1500.0, 1500.0, 100.0}};
+	vector<Sdl::CollisionHit> hits;
+	batch.testCollisions(circles.data(), 1, hits);
+	
+	for ( int i = 0; i < 1000; i += 7 ) {
+		rectangles[i] = {random.uniform(1400.0, 1600.0),
+		                 random.uniform(1400.0, 1600.0), 20.0, 20.0};
+		batch.set(i, rectangles[i]);
+	}
+	
+	vector<Sdl::CollisionHit> expected;
+	findHits(circles, rectangles, expected);
+	
+	hits.clear();
+	batch.testCollisions(circles.data(), 1, hits);
+	Testing::check(isSame(hits, expected), "rectangles moved after a test");
+	
+	batch.clear();
+	hits.clear();
+	batch.testCollisions(circles.data(), 1, hits);
+	Testing::check(hits.empty(), "cleared batch");
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	Testing::Random random;
+	
+	for ( int rectangleCount : {0, 1, 3, 255, 256, 257, 1000, 20000} )
+		testScene(rectangleCount, random);
+	
+	testChanges(random);
+	
+	return Testing::report();
+}
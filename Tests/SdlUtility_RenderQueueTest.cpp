@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : SdlUtility_RenderQueueTest.cpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Order of the blits of a RenderQueue : by layer, then in the
+//               order of submission whatever the sources, and the culling of
+//               those outside the viewport.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../SdlUtility.hpp"
+#include "Testing.hpp"
+
+using namespace std;
+
+
+//{ Functions
+
+// An opaque square of a single color, which applySurface blends itself.
+SDL_Surface* createSquare ( int size, Uint32 color )
+{
+	SDL_Surface* square = SDL_CreateRGBSurface(SDL_SWSURFACE | SDL_SRCALPHA,
+	                                           size, size, 32, 0x00FF0000,
+	                                           0x0000FF00, 0x000000FF,
+	                                           0xFF000000);
+	
+	for ( int i = 0; i < size * size; i ++ )
+		((Uint32*)square->pixels)[i] = color | 0xFF000000;
+	
+	return square;
+}
+
+
+Uint32 getPixel ( SDL_Surface* surface, int x, int y )
+{
+	Uint8* row = (Uint8*)surface->pixels + y * surface->pitch;
+	
+	return ((Uint32*)row)[x] & 0x00FFFFFF;
+}
+
+
+// Squares drawn over each other in a random order : the last one submitted
+// to the highest layer must be on top, whatever the addresses of the sources.
+void testOrder ( SDL_Surface* screen, vector<SDL_Surface*>& squares,
+                 Testing::Random& random )
+{
+	Sdl::RenderQueue queue(screen->w, screen->h);
+	int lastSquare = int(squares.size()) - 1;
+	
+	for ( int trial = 0; trial < 100; trial ++ ) {
+		int topLayer = random.uniform(0, 2);
+		SDL_Surface* top = NULL;
+		
+		for ( int i = 0; i < 20; i ++ ) {
+			SDL_Surface* square = squares[random.uniform(0, lastSquare)];
+			int layer = random.uniform(0, topLayer);
+			
+			queue.submit(square, 8, 8, NULL, layer);
+			if ( layer == topLayer )
+				top = square;
+		}
+		
+		if ( top == NULL ) {
+			top = squares[0];
+			queue.submit(top, 8, 8, NULL, topLayer);
+		}
+		
+		queue.execute(screen);
+		
+		if ( not Testing::check(getPixel(screen, 12, 12) ==
+		                        getPixel(top, 0, 0),
+		                        "RenderQueue, last square of the top layer, "
+		                        "trial " + to_string(trial)) )
+			break;
+	}
+}
+
+
+void testCulling ( SDL_Surface* screen, SDL_Surface* square )
+{
+	Sdl::RenderQueue queue(screen->w, screen->h);
+	queue.setViewport(100, 100);
+	
+	queue.submit(square, 100, 100);
+	queue.submit(square, 100 + screen->w, 100);
+	queue.submit(square, 100 - square->w, 100);
+	queue.submit(square, 102 - square->w, 102 - square->h);  // In a corner
+	
+	Testing::check(queue.getSize() == 4, "RenderQueue::getSize");
+	
+	queue.execute(screen);
+	
+	Testing::check(queue.getSize() == 0, "RenderQueue cleared by execute");
+	Testing::check(queue.getDrawnCount() == 2 and
+	               queue.getCulledCount() == 2,
+	               "RenderQueue, commands outside the viewport culled");
+}
+
+//}
+
+
+
+
+int main ( )
+{
+	Testing::Random random;
+	
+	SDL_Surface* screen = SDL_CreateRGBSurface(SDL_SWSURFACE, 64, 64, 32,
+	                                           0x00FF0000, 0x0000FF00,
+	                                           0x000000FF, 0);
+	
+	vector<SDL_Surface*> squares;
+	for ( int i = 0; i < 8; i ++ )
+		squares.push_back(createSquare(16, 0x00102030 * (i + 1)));
+	
+	testOrder(screen, squares, random);
+	testCulling(screen, squares[0]);
+	
+	for ( SDL_Surface* square : squares )
+		SDL_FreeSurface(square);
+	SDL_FreeSurface(screen);
+	
+	return Testing::report();
+}
@@ -0,0 +1,179 @@
+////////////////////////////////////////////////////////////////////////////////
+//        FILE : Testing.hpp
+//      AUTHOR : Charles Hosson
+//        DATE :   Creation : October 18 2026
+//               Last entry : October 18 2026
+// DESCRIPTION : Checks and timings shared by the tests and the benchmarks.
+//     REMARKS : All functions in this file are under the namespace 'Testing'.
+//               A test calls check() for each expectation and returns
+//               report() from main, so that make stops on the first failed
+//               program.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+using namespace std;
+
+
+//{ Includes
+
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+//}
+
+
+namespace Testing
+{
+
+//{ Declarations
+
+// Random numbers reproducible from one run to the next (xorshift64*).
+class Random
+{
+public:
+	// Constructor
+	Random ( uint64_t = 88172645463325252ULL );
+	
+	// Modifying methods
+	uint64_t next ( );
+	     int uniform ( int, int );        // In [first, last]
+	  double uniform ( double, double );  // In [first, last)
+	
+protected:
+	// Attributes
+	uint64_t state_;
+};
+
+
+bool check ( bool, const string& );
+ int report ( );
+
+template <typename Function>
+double measure ( Function, double = 0.25 );
+  void printRate ( const string&, double, double, double );
+
+//}
+
+
+//{ Random
+
+inline
+Random::Random ( uint64_t seed )
+{
+	state_ = seed != 0 ? seed : 1;
+}
+
+
+inline
+uint64_t Random::next ( )
+{
+	state_ ^= state_ >> 12;
+	state_ ^= state_ << 25;
+	state_ ^= state_ >> 27;
+	
+	return state_ * 2685821657736338717ULL;
+}
+
+
+inline
+int Random::uniform ( int first, int last )
+{
+	return first + int((*this).next() % uint64_t(last - first + 1));
+}
+
+
+inline
+double Random::uniform ( double first, double last )
+{
+	return first + (last - first) * ((*this).next() >> 11) * 0x1.0p-53;
+}
+
+//}
+
+
+//{ Functions
+
+inline
+int& failureCount ( )
+{
+	static int count = 0;
+	return count;
+}
+
+
+// Prints the failed expectations; the passed ones are only counted.
+inline
+bool check ( bool isPassed, const string& description )
+{
+	if ( not isPassed ) {
+		failureCount() ++;
+		cerr << "FAILED : " << description << endl;
+	}
+	
+	return isPassed;
+}
+
+
+// Exit status of the test.
+inline
+int report ( )
+{
+	if ( failureCount() == 0 ) {
+		cout << "All checks passed." << endl;
+		return 0;
+	}
+	
+	cout << failureCount() << " check(s) failed." << endl;
+	return 1;
+}
+
+
+// Seconds per call, from as many calls as fit in the given duration after
+// one warm-up call.
+template <typename Function>
+double measure ( Function function, double minDuration )
+{
+	typedef chrono::steady_clock Clock;
+	
+	function();
+	
+	long calls = 0;
+	Clock::time_point start = Clock::now();
+	double elapsed;
+	
+	do {
+		function();
+		calls ++;
+		elapsed = chrono::duration<double>(Clock::now() - start).count();
+	} while ( elapsed < minDuration );
+	
+	return elapsed / calls;
+}
+
+
+// One line per measure : time per call, MB/s and items/s for the bytes and
+// the items processed by each call. A zero byte count leaves out the MB/s.
+inline
+void printRate ( const string& name, double bytes, double items,
+                 double seconds )
+{
+	cout << left << setw(36) << name << right << fixed << setprecision(3)
+	     << setw(12) << seconds * 1e6 << " us";
+	
+	if ( bytes > 0.0 )
+		cout << setw(12) << setprecision(1) << bytes / seconds / 1e6
+		     << " MB/s";
+	else
+		cout << setw(17) << "";
+	
+	cout << setw(14) << setprecision(0) << items / seconds << " items/s"
+	     << endl;
+}
+
+//}
+
+}